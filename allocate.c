@@ -33,6 +33,7 @@
 #include <stdlib.h>
 #include <stddef.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "lib.h"
 #include "allocate.h"
@@ -43,11 +44,86 @@
 #include "expression.h"
 #include "linearize.h"
 
+/*
+ * The number of bytes which are currently held in blobs.  Other allocators
+ * such as the stree nodes add themselves in as well so that Smatch can see
+ * how much memory a function is really using.
+ */
+unsigned long allocated_bytes;
+
 void protect_allocations(struct allocator_struct *desc)
 {
 	desc->blobs = NULL;
 }
 
+/*
+ * When an arena is released we keep this much around for the next user
+ * instead of giving it back.
+ */
+#define ARENA_KEEP_BYTES (32 * 1024 * 1024)
+#define ARENA_REGION (2 * 1024 * 1024)
+
+static struct allocation_blob *arena_blob_alloc(struct arena *arena)
+{
+	struct allocation_blob *blob;
+
+	blob = arena->free_blobs;
+	if (blob) {
+		arena->free_blobs = blob->next;
+		arena->free_bytes -= CHUNK;
+		memset(blob, 0, CHUNK);
+		goto out;
+	}
+
+	if (!arena->huge_pages) {
+		blob = blob_alloc(CHUNK);
+		goto out;
+	}
+
+	/*
+	 * With huge pages the blobs are cut out of big regions and they
+	 * never go back to the system.
+	 */
+	if (arena->region_left < CHUNK) {
+		arena->region = blob_alloc_huge(ARENA_REGION);
+		if (!arena->region)
+			return NULL;
+		arena->region_left = ARENA_REGION;
+	}
+	blob = (struct allocation_blob *)arena->region;
+	arena->region += CHUNK;
+	arena->region_left -= CHUNK;
+out:
+	arena->bytes += CHUNK;
+	if (arena->bytes > arena->high_water)
+		arena->high_water = arena->bytes;
+	return blob;
+}
+
+static void arena_blob_free(struct arena *arena, struct allocation_blob *blob)
+{
+	arena->bytes -= CHUNK;
+	if (arena->huge_pages || arena->free_bytes < ARENA_KEEP_BYTES) {
+		blob->next = arena->free_blobs;
+		arena->free_blobs = blob;
+		arena->free_bytes += CHUNK;
+		return;
+	}
+	blob_free(blob, CHUNK);
+}
+
+static void destroy_entries(struct allocator_struct *desc, struct allocation_blob *blob)
+{
+	unsigned int size = desc->entry_size;
+	unsigned int offset = 0;
+
+	size = (size + desc->alignment - 1) & ~(desc->alignment - 1);
+	while (offset < blob->offset) {
+		desc->destroy(blob->data + offset);
+		offset += size;
+	}
+}
+
 void drop_all_allocations(struct allocator_struct *desc)
 {
 	struct allocation_blob *blob = desc->blobs;
@@ -59,11 +135,33 @@ void drop_all_allocations(struct allocator_struct *desc)
 	desc->freelist = NULL;
 	while (blob) {
 		struct allocation_blob *next = blob->next;
-		blob_free(blob, desc->chunking);
+		if (desc->destroy)
+			destroy_entries(desc, blob);
+		if (desc->arena)
+			arena_blob_free(desc->arena, blob);
+		else
+			blob_free(blob, desc->chunking);
+		allocated_bytes -= desc->chunking;
 		blob = next;
 	}
 }
 
+void arena_release(struct arena *arena)
+{
+	struct allocator_struct *desc;
+
+	for (desc = arena->allocators; desc; desc = desc->arena_next)
+		drop_all_allocations(desc);
+	arena->releases++;
+}
+
+void show_arena(struct arena *arena)
+{
+	fprintf(stderr, "%s: %lu releases, %lu bytes high water, %lu bytes kept\n",
+		arena->name, arena->releases, arena->high_water,
+		arena->free_bytes);
+}
+
 void free_one_entry(struct allocator_struct *desc, void *entry)
 {
 	void **p = entry;
@@ -100,10 +198,22 @@ void *allocate(struct allocator_struct *desc, unsigned int size)
 	size = (size + alignment - 1) & ~(alignment-1);
 	if (!blob || blob->left < size) {
 		unsigned int offset, chunking = desc->chunking;
-		struct allocation_blob *newblob = blob_alloc(chunking);
+		struct allocation_blob *newblob;
+
+		if (desc->arena) {
+			newblob = arena_blob_alloc(desc->arena);
+			if (!desc->in_arena) {
+				desc->arena_next = desc->arena->allocators;
+				desc->arena->allocators = desc;
+				desc->in_arena = 1;
+			}
+		} else {
+			newblob = blob_alloc(chunking);
+		}
 		if (!newblob)
 			die("out of memory");
 		desc->total_bytes += chunking;
+		allocated_bytes += chunking;
 		newblob->next = blob;
 		blob = newblob;
 		desc->blobs = newblob;
@@ -7,16 +7,46 @@ struct allocation_blob {
 	unsigned char data[];
 };
 
+struct arena;
+
 struct allocator_struct {
 	const char *name;
 	struct allocation_blob *blobs;
 	unsigned int alignment;
 	unsigned int chunking;
 	void *freelist;
+	/* arena allocators */
+	struct arena *arena;
+	struct allocator_struct *arena_next;
+	int in_arena;
+	unsigned int entry_size;
+	void (*destroy)(void *entry);
 	/* statistics */
 	unsigned int allocations, total_bytes, useful_bytes;
 };
 
+/*
+ * An arena is a group of allocators which are all dropped at the same time
+ * with arena_release().  The blobs are kept on a free list and handed out
+ * again instead of going back to the system each time.
+ */
+struct arena {
+	const char *name;
+	struct allocator_struct *allocators;
+	struct allocation_blob *free_blobs;
+	unsigned long free_bytes;
+	unsigned char *region;
+	unsigned long region_left;
+	int huge_pages;
+	/* statistics */
+	unsigned long bytes, high_water, releases;
+};
+
+extern unsigned long allocated_bytes;
+
+extern void arena_release(struct arena *arena);
+extern void show_arena(struct arena *arena);
+
 extern void protect_allocations(struct allocator_struct *desc);
 extern void drop_all_allocations(struct allocator_struct *desc);
 extern void *allocate(struct allocator_struct *desc, unsigned int size);
@@ -31,11 +61,14 @@ extern void show_allocations(struct allocator_struct *);
 	extern void protect_##x##_alloc(void);
 #define DECLARE_ALLOCATOR(x) __DECLARE_ALLOCATOR(struct x, x)
 
-#define __DO_ALLOCATOR(type, objsize, objalign, objname, x)	\
+#define __DO_ARENA_ALLOCATOR(type, objsize, objalign, objname, x, _arena, _destroy) \
 	static struct allocator_struct x##_allocator = {	\
 		.name = objname,				\
 		.alignment = objalign,				\
-		.chunking = CHUNK };				\
+		.chunking = CHUNK,				\
+		.arena = _arena,				\
+		.entry_size = objsize,				\
+		.destroy = _destroy };				\
 	type *__alloc_##x(int extra)				\
 	{							\
 		return allocate(&x##_allocator, objsize+extra);	\
@@ -57,11 +90,19 @@ extern void show_allocations(struct allocator_struct *);
 		protect_allocations(&x##_allocator);		\
 	}
 
+#define __DO_ALLOCATOR(type, objsize, objalign, objname, x)	\
+	__DO_ARENA_ALLOCATOR(type, objsize, objalign, objname, x, NULL, NULL)
+
 #define __ALLOCATOR(t, n, x) 					\
 	__DO_ALLOCATOR(t, sizeof(t), __alignof__(t), n, x)
 
 #define ALLOCATOR(x, n) __ALLOCATOR(struct x, n, x)
 
+#define __ARENA_ALLOCATOR(t, n, x, arena, destroy)		\
+	__DO_ARENA_ALLOCATOR(t, sizeof(t), __alignof__(t), n, x, arena, destroy)
+
+#define ARENA_ALLOCATOR(x, n, arena, destroy) __ARENA_ALLOCATOR(struct x, n, x, arena, destroy)
+
 DECLARE_ALLOCATOR(ident);
 DECLARE_ALLOCATOR(token);
 DECLARE_ALLOCATOR(context);
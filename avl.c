@@ -28,10 +28,11 @@
 
 static AvlNode *mkNode(const struct sm_state *sm);
 static void freeNode(AvlNode *node);
+static AvlNode *own_node(AvlNode **p);
 
 static AvlNode *lookup(const struct stree *avl, AvlNode *node, const struct sm_state *sm);
 
-static bool insert_sm(struct stree *avl, AvlNode **p, const struct sm_state *sm);
+static bool insert_sm(struct stree *avl, AvlNode **p, const struct sm_state *sm, bool *changed);
 static bool remove_sm(struct stree *avl, AvlNode **p, const struct sm_state *sm, AvlNode **ret);
 static bool removeExtremum(AvlNode **p, int side, AvlNode **ret);
 
@@ -43,6 +44,7 @@ static bool checkOrder(struct stree *avl);
 static size_t countNode(AvlNode *node);
 
 int unfree_stree;
+unsigned long stree_generation;
 
 /*
  * Utility macros for converting between
@@ -56,12 +58,21 @@ int unfree_stree;
 #define bal(side) ((side) == 0 ? -1 : 1)
 #define side(bal) ((bal)  == 1 ?  1 : 0)
 
+/*
+ * The nodes are shared between strees.  Cloning an stree just takes a
+ * reference to the root node and a node is only copied when it is on the
+ * path to a node that we are changing.  A node with more than one
+ * reference is never modified so if two strees have the same node pointer
+ * then the whole subtree under it is the same.
+ */
+
 struct stree *avl_new(void)
 {
 	struct stree *avl = malloc(sizeof(*avl));
 
 	unfree_stree++;
 	assert(avl != NULL);
+	allocated_bytes += sizeof(*avl);
 
 	avl->root = NULL;
 	avl->base_stree = NULL;
@@ -85,9 +96,11 @@ void free_stree(struct stree **avl)
 	}
 
 	unfree_stree--;
+	stree_generation++;
 
 	freeNode((*avl)->root);
 	free(*avl);
+	allocated_bytes -= sizeof(**avl);
 	*avl = NULL;
 }
 
@@ -115,13 +128,24 @@ size_t stree_count(const struct stree *avl)
 	return avl->count;
 }
 
-static struct stree *clone_stree_real(struct stree *orig)
+struct stree *copy_stree(struct stree *orig)
 {
-	struct stree *new = avl_new();
-	AvlIter i;
+	struct stree *new;
+
+	if (!orig)
+		return NULL;
+
+	new = avl_new();
+	new->root = orig->root;
+	if (new->root)
+		new->root->references++;
+	new->count = orig->count;
+	return new;
+}
 
-	avl_foreach(i, orig)
-		avl_insert(&new, i.sm);
+static struct stree *clone_stree_real(struct stree *orig)
+{
+	struct stree *new = copy_stree(orig);
 
 	new->base_stree = orig->base_stree;
 	return new;
@@ -130,15 +154,23 @@ static struct stree *clone_stree_real(struct stree *orig)
 bool avl_insert(struct stree **avl, const struct sm_state *sm)
 {
 	size_t old_count;
+	bool changed = false;
 
 	if (!*avl)
 		*avl = avl_new();
 	if ((*avl)->references > 1) {
+		/* don't unshare the stree if the sm is already there */
+		AvlNode *found = lookup(*avl, (*avl)->root, sm);
+
+		if (found && found->sm == sm)
+			return false;
 		(*avl)->references--;
 		*avl = clone_stree_real(*avl);
 	}
 	old_count = (*avl)->count;
-	insert_sm(*avl, &(*avl)->root, sm);
+	insert_sm(*avl, &(*avl)->root, sm, &changed);
+	if (changed)
+		stree_generation++;
 	return (*avl)->count != old_count;
 }
 
@@ -153,6 +185,7 @@ bool avl_remove(struct stree **avl, const struct sm_state *sm)
 		(*avl)->references--;
 		*avl = clone_stree_real(*avl);
 	}
+	stree_generation++;
 
 	remove_sm(*avl, &(*avl)->root, sm, &node);
 
@@ -163,6 +196,7 @@ bool avl_remove(struct stree **avl, const struct sm_state *sm)
 		return false;
 	} else {
 		free(node);
+		allocated_bytes -= sizeof(*node);
 		return true;
 	}
 }
@@ -172,21 +206,51 @@ static AvlNode *mkNode(const struct sm_state *sm)
 	AvlNode *node = malloc(sizeof(*node));
 
 	assert(node != NULL);
+	allocated_bytes += sizeof(*node);
 
 	node->sm = sm;
 	node->lr[0] = NULL;
 	node->lr[1] = NULL;
 	node->balance = 0;
+	node->references = 1;
 	return node;
 }
 
 static void freeNode(AvlNode *node)
 {
-	if (node) {
-		freeNode(node->lr[0]);
-		freeNode(node->lr[1]);
-		free(node);
-	}
+	if (!node)
+		return;
+	if (--node->references > 0)
+		return;
+	freeNode(node->lr[0]);
+	freeNode(node->lr[1]);
+	free(node);
+	allocated_bytes -= sizeof(*node);
+}
+
+/*
+ * Make sure that *p is only referenced from this stree so it can be
+ * modified.  The caller must already own the parent of *p.
+ */
+static AvlNode *own_node(AvlNode **p)
+{
+	AvlNode *node = *p;
+	AvlNode *copy;
+
+	if (node->references == 1)
+		return node;
+
+	copy = mkNode(node->sm);
+	copy->lr[0] = node->lr[0];
+	copy->lr[1] = node->lr[1];
+	copy->balance = node->balance;
+	if (copy->lr[0])
+		copy->lr[0]->references++;
+	if (copy->lr[1])
+		copy->lr[1]->references++;
+	node->references--;
+	*p = copy;
+	return copy;
 }
 
 static AvlNode *lookup(const struct stree *avl, AvlNode *node, const struct sm_state *sm)
@@ -210,22 +274,28 @@ static AvlNode *lookup(const struct stree *avl, AvlNode *node, const struct sm_s
  *
  * Return true if the subtree's height increased.
  */
-static bool insert_sm(struct stree *avl, AvlNode **p, const struct sm_state *sm)
+static bool insert_sm(struct stree *avl, AvlNode **p, const struct sm_state *sm, bool *changed)
 {
 	if (*p == NULL) {
 		*p = mkNode(sm);
 		avl->count++;
+		*changed = true;
 		return true;
 	} else {
 		AvlNode *node = *p;
 		int      cmp  = cmp_tracker(sm, node->sm);
 
+		if (cmp == 0 && node->sm == sm)
+			return false;
+
+		node = own_node(p);
 		if (cmp == 0) {
 			node->sm = sm;
+			*changed = true;
 			return false;
 		}
 
-		if (!insert_sm(avl, &node->lr[side(cmp)], sm))
+		if (!insert_sm(avl, &node->lr[side(cmp)], sm, changed))
 			return false;
 
 		/* If tree's balance became -1 or 1, it means the tree's height grew due to insertion. */
@@ -245,7 +315,7 @@ static bool remove_sm(struct stree *avl, AvlNode **p, const struct sm_state *sm,
 	if (p == NULL || *p == NULL) {
 		return false;
 	} else {
-		AvlNode *node = *p;
+		AvlNode *node = own_node(p);
 		int      cmp  = cmp_tracker(sm, node->sm);
 
 		if (cmp == 0) {
@@ -305,7 +375,7 @@ static bool remove_sm(struct stree *avl, AvlNode **p, const struct sm_state *sm,
  */
 static bool removeExtremum(AvlNode **p, int side, AvlNode **ret)
 {
-	AvlNode *node = *p;
+	AvlNode *node = own_node(p);
 
 	if (node->lr[side] == NULL) {
 		*ret = node;
@@ -348,7 +418,7 @@ static int sway(AvlNode **p, int sway)
 static void balance(AvlNode **p, int side)
 {
 	AvlNode  *node  = *p,
-	         *child = node->lr[side];
+	         *child = own_node(&node->lr[side]);
 	int opposite    = 1 - side;
 	int bal         = bal(side);
 
@@ -363,7 +433,7 @@ static void balance(AvlNode **p, int side)
 
 	} else {
 		/* Left-right (side == 0) or right-left (side == 1) */
-		AvlNode *grandchild = child->lr[opposite];
+		AvlNode *grandchild = own_node(&child->lr[opposite]);
 
 		node->lr[side]           = grandchild->lr[opposite];
 		child->lr[opposite]      = grandchild->lr[side];
@@ -492,6 +562,63 @@ void avl_iter_next(AvlIter *iter)
 	iter->sm   = (struct sm_state *) node->sm;
 }
 
+void avl_iter_next_skip(AvlIter *iter)
+{
+	AvlNode *node;
+
+	if (iter->node == NULL)
+		return;
+
+	if (iter->stack_index == 0) {
+		iter->sm   = NULL;
+		iter->node = NULL;
+		return;
+	}
+
+	node = iter->stack[--iter->stack_index];
+	iter->node = node;
+	iter->sm   = (struct sm_state *) node->sm;
+}
+
+/* the owner and name part of cmp_tracker() */
+static int cmp_owner_name(int owner, const char *name, const struct sm_state *sm)
+{
+	if (owner > sm->owner)
+		return -1;
+	if (owner < sm->owner)
+		return 1;
+	return strcmp(name, sm->name);
+}
+
+void avl_iter_seek(AvlIter *iter, struct stree *avl, int owner, const char *name)
+{
+	AvlNode *node;
+
+	iter->stack_index = 0;
+	iter->direction   = FORWARD;
+	iter->sm          = NULL;
+	iter->node        = NULL;
+
+	if (!avl)
+		return;
+
+	node = avl->root;
+	while (node) {
+		if (cmp_owner_name(owner, name, node->sm) <= 0) {
+			iter->stack[iter->stack_index++] = node;
+			node = node->lr[FORWARD];
+		} else {
+			node = node->lr[1 - FORWARD];
+		}
+	}
+
+	if (iter->stack_index == 0)
+		return;
+	node = iter->stack[--iter->stack_index];
+	iter->node = node;
+	iter->sm   = (struct sm_state *)node->sm;
+}
+
 struct stree *clone_stree(struct stree *orig)
 {
 	if (!orig)
@@ -39,6 +39,12 @@ struct stree {
 	int references;
 };
 
+extern unsigned long stree_generation;
+	/*
+	 * Bumped every time any stree is changed or freed.  If it hasn't
+	 * moved then every stree still holds what it held before.
+	 */
+
 void free_stree(struct stree **avl);
 	/* Free an stree tree. */
 
@@ -114,6 +120,18 @@ struct AvlIter {
 
 void avl_iter_begin(AvlIter *iter, struct stree *avl, AvlDirection dir);
 void avl_iter_next(AvlIter *iter);
+void avl_iter_next_skip(AvlIter *iter);
+	/*
+	 * Like avl_iter_next() but skip the rest of the subtree under the
+	 * current node.  If two iterators are on the same node then the
+	 * subtrees are shared and can be skipped together.
+	 */
+void avl_iter_seek(AvlIter *iter, struct stree *avl, int owner, const char *name);
+	/*
+	 * O(log n).  Start a forward traversal at the first sm which belongs
+	 * to owner and has a name >= name.  The sms for an owner are sorted by
+	 * name so all the names which start with a prefix are together.
+	 */
 #define avl_traverse(iter, avl, direction)        \
 	for (avl_iter_begin(&(iter), avl, direction); \
 	     (iter).node != NULL;                     \
@@ -127,12 +145,15 @@ struct AvlNode {
 
 	AvlNode    *lr[2];
 	int         balance; /* -1, 0, or 1 */
+	int         references;
 };
 
 AvlNode *avl_lookup_node(const struct stree *avl, const struct sm_state *sm);
 	/* O(log n). Lookup an stree node by sm.  Return NULL if not present. */
 
 struct stree *clone_stree(struct stree *orig);
+struct stree *copy_stree(struct stree *orig);
+	/* O(1). A new stree which shares the nodes of orig. */
 
 void set_stree_id(struct stree **stree, int id);
 int get_stree_id(struct stree *stree);
@@ -59,7 +59,7 @@ static void match_state(const char *fn, struct expression *expr, void *info)
 			continue;
 		if (strcmp(sm->name, state_arg->string->data) != 0)
 			continue;
-		sm_msg("'%s' = '%s'", sm->name, sm->state->name);
+		sm_msg("'%s' = '%s'", sm->name, show_state(sm->state));
 		found = 1;
 	} END_FOR_EACH_SM(sm);
 
@@ -110,7 +110,7 @@ static void match_print_value(const char *fn, struct expression *expr, void *inf
 	stree = __get_cur_stree();
 	FOR_EACH_MY_SM(SMATCH_EXTRA, stree, tmp) {
 		if (!strcmp(tmp->name, arg_expr->string->data))
-			sm_msg("%s = %s", tmp->name, tmp->state->name);
+			sm_msg("%s = %s", tmp->name, show_state(tmp->state));
 	} END_FOR_EACH_SM(tmp);
 }
 
@@ -328,7 +328,7 @@ static void print_possible(struct sm_state *sm)
 
 	sm_msg("Possible values for %s", sm->name);
 	FOR_EACH_PTR(sm->possible, tmp) {
-		printf("%s\n", tmp->state->name);
+		printf("%s\n", show_state(tmp->state));
 	} END_FOR_EACH_PTR(tmp);
 	sm_msg("===");
 }
@@ -352,6 +352,32 @@ static void match_possible(const char *fn, struct expression *expr, void *info)
 	} END_FOR_EACH_SM(tmp);
 }
 
+static void match_possible_cover(const char *fn, struct expression *expr, void *info)
+{
+	struct expression *arg_expr;
+	struct range_list *rl;
+	struct sm_state *sm, *tmp;
+	int cnt;
+
+	arg_expr = get_argument_from_call_expr(expr->args, 0);
+	if (arg_expr->type != EXPR_STRING) {
+		sm_msg("error:  the argument to %s is supposed to be a string literal", fn);
+		return;
+	}
+
+	FOR_EACH_MY_SM(SMATCH_EXTRA, __get_cur_stree(), sm) {
+		if (strcmp(sm->name, arg_expr->string->data) != 0)
+			continue;
+		rl = NULL;
+		cnt = 0;
+		FOR_EACH_PTR(sm->possible, tmp) {
+			rl = rl_union(rl, estate_rl(tmp->state));
+			cnt++;
+		} END_FOR_EACH_PTR(tmp);
+		sm_msg("'%s' %d possible states cover '%s'", sm->name, cnt, show_rl(rl));
+	} END_FOR_EACH_SM(sm);
+}
+
 static void match_strlen(const char *fn, struct expression *expr, void *info)
 {
 	struct expression *arg;
@@ -461,6 +487,19 @@ static void match_compare(const char *fn, struct expression *expr, void *info)
 	free_string(two_name);
 }
 
+static void match_mem_budget_used(const char *fn, struct expression *expr, void *info)
+{
+	struct expression *arg;
+	sval_t sval;
+
+	arg = get_argument_from_call_expr(expr->args, 0);
+	if (!get_value(arg, &sval)) {
+		sm_msg("error:  the argument to %s is supposed to be a number", fn);
+		return;
+	}
+	__use_mem_budget(sval.value);
+}
+
 static void match_debug_on(const char *fn, struct expression *expr, void *info)
 {
 	option_debug = 1;
@@ -594,7 +633,7 @@ static void trace_var(struct statement *stmt)
 			continue;
 		sm_msg("[%d] %s '%s': '%s' => '%s'", stmt->type,
 		       check_name(sm->owner),
-		       sm->name, old ? old->state->name : "<none>", sm->state->name);
+		       sm->name, old ? show_state(old->state) : "<none>", show_state(sm->state));
 	} END_FOR_EACH_SM(sm);
 
 	free_stree(&old_stree);
@@ -627,6 +666,7 @@ void check_debug(int id)
 	add_function_hook("__smatch_sval_info", &match_sval_info, NULL);
 	add_function_hook("__smatch_member_name", &match_member_name, NULL);
 	add_function_hook("__smatch_possible", &match_possible, NULL);
+	add_function_hook("__smatch_possible_cover", &match_possible_cover, NULL);
 	add_function_hook("__smatch_cur_stree", &match_cur_stree, NULL);
 	add_function_hook("__smatch_strlen", &match_strlen, NULL);
 	add_function_hook("__smatch_buf_size", &match_buf_size, NULL);
@@ -634,6 +674,7 @@ void check_debug(int id)
 	add_function_hook("__smatch_note", &match_note, NULL);
 	add_function_hook("__smatch_dump_related", &match_dump_related, NULL);
 	add_function_hook("__smatch_compare", &match_compare, NULL);
+	add_function_hook("__smatch_mem_budget_used", &match_mem_budget_used, NULL);
 	add_function_hook("__smatch_debug_on", &match_debug_on, NULL);
 	add_function_hook("__smatch_debug_check", &match_debug_check, NULL);
 	add_function_hook("__smatch_debug_off", &match_debug_off, NULL);
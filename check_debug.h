@@ -27,6 +27,7 @@ static inline void __smatch_sval_info(long long val){}
 static inline void __smatch_member_name(long long val){}
 
 static inline void __smatch_possible(const char *unused){}
+static inline void __smatch_possible_cover(const char *unused){}
 static inline void __smatch_print_value(const char *unused){}
 
 static inline void __smatch_strlen(const void *buf){}
@@ -39,6 +40,8 @@ static inline void __smatch_dump_related(void){}
 
 static inline void __smatch_compare(long long one, long long two){}
 
+static inline void __smatch_mem_budget_used(int percent){}
+
 static inline void __smatch_debug_on(void){}
 static inline void __smatch_debug_check(const char *check_name){}
 static inline void __smatch_debug_off(void){}
@@ -96,7 +96,7 @@ static void check_dereference(struct expression *expr)
 			return;
 		}
 		sm_msg("error: potential null dereference '%s'.  (%s returns null)",
-			tmp->name, tmp->state->name);
+			tmp->name, show_state(tmp->state));
 		return;
 	} END_FOR_EACH_PTR(tmp);
 }
@@ -133,7 +133,7 @@ static void check_dereference_name_sym(char *name, struct symbol *sym)
 			return;
 		}
 		sm_msg("error: potential null dereference '%s'.  (%s returns null)",
-			tmp->name, tmp->state->name);
+			tmp->name, show_state(tmp->state));
 		return;
 	} END_FOR_EACH_PTR(tmp);
 }
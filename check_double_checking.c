@@ -215,7 +215,7 @@ static void match_condition(struct expression *expr)
 		return;
 
 	name = expr_to_str(expr);
-	sm_msg("warn: we tested '%s' before and it was '%s'", name, state->name);
+	sm_msg("warn: we tested '%s' before and it was '%s'", name, show_state(state));
 	free_string(name);
 }
 
@@ -230,7 +230,7 @@ static int is_null(const char *name, struct symbol *sym)
 	struct smatch_state *state;
 
 	state = get_state(my_id, name, sym);
-	if (state && !strcmp(state->name, "isnull"))
+	if (state && !strcmp(show_state(state), "isnull"))
 		return 1;
 	return 0;
 }
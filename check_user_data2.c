@@ -504,7 +504,7 @@ static void struct_member_callback(struct expression *call, int param, char *pri
 	struct smatch_state *state;
 	struct range_list *rl;
 
-	if (strcmp(sm->state->name, "") == 0)
+	if (strcmp(show_state(sm->state), "") == 0)
 		return;
 
 	state = get_state(SMATCH_EXTRA, sm->name, sm->sym);
@@ -47,6 +47,20 @@ void blob_free(void *addr, unsigned long size)
 	free(addr);	
 }	
 	
+void *blob_alloc_huge(unsigned long size)
+{
+	return blob_alloc(size);
+}
+
+void *map_file(int fd, unsigned long size)
+{
+	return NULL;
+}
+
+void unmap_file(void *addr, unsigned long size)
+{
+}
+
 long double string_to_ld(const char *nptr, char **endptr) 	
 {	
 	return strtod(nptr, endptr);	
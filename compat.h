@@ -7,6 +7,8 @@
  *
  *  - zeroed anonymous mmap
  *	Missing in MinGW
+ *  - read-only mmap of a source file
+ *	Missing in MinGW, not used on Cygwin
  *  - "string to long double" (C99 strtold())
  *	Missing in Solaris and MinGW
  */
@@ -23,6 +25,9 @@ struct stat;
 
 void *blob_alloc(unsigned long size);
 void blob_free(void *addr, unsigned long size);
+void *blob_alloc_huge(unsigned long size);
+void *map_file(int fd, unsigned long size);
+void unmap_file(void *addr, unsigned long size);
 long double string_to_ld(const char *nptr, char **endptr);
 
 #endif
@@ -35,3 +35,45 @@ void blob_free(void *addr, unsigned long size)
 	mprotect(addr, size, PROT_NONE);
 #endif
 }
+
+/*
+ * A big region which is never freed.  It's aligned to "size" so that the
+ * kernel can back it with transparent huge pages.
+ */
+void *blob_alloc_huge(unsigned long size)
+{
+	unsigned char *ptr, *aligned;
+	unsigned long extra;
+
+	ptr = mmap(NULL, size * 2, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (ptr == MAP_FAILED)
+		return NULL;
+	aligned = (unsigned char *)(((unsigned long)ptr + size - 1) & ~(size - 1));
+	extra = aligned - ptr;
+	if (extra)
+		munmap(ptr, extra);
+	munmap(aligned + size, size - extra);
+#ifdef MADV_HUGEPAGE
+	madvise(aligned, size, MADV_HUGEPAGE);
+#endif
+	return aligned;
+}
+
+/*
+ * Map a whole source file so the tokenizer can read it straight from the
+ * page cache.  Returns NULL if it can't, then the caller uses read().
+ */
+void *map_file(int fd, unsigned long size)
+{
+	void *ptr;
+
+	ptr = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (ptr == MAP_FAILED)
+		return NULL;
+	return ptr;
+}
+
+void unmap_file(void *addr, unsigned long size)
+{
+	munmap(addr, size);
+}
@@ -47,6 +47,7 @@
 
 int verbose, optimize, optimize_size, preprocessing;
 int die_if_error = 0;
+int diagnostic_count;
 
 #ifndef __GNUC__
 # define __GNUC__ 2
@@ -129,6 +130,8 @@ void info(struct position pos, const char * fmt, ...)
 static void do_error(struct position pos, const char * fmt, va_list args)
 {
 	static int errors = 0;
+
+	diagnostic_count++;
         die_if_error = 1;
 	show_info = 1;
 	/* Shut up warnings after an error */
@@ -150,6 +153,7 @@ void warning(struct position pos, const char * fmt, ...)
 {
 	va_list args;
 
+	diagnostic_count++;
 	if (Werror) {
 		va_start(args, fmt);
 		do_error(pos, fmt, args);
@@ -618,6 +622,11 @@ static char **handle_switch_f(char *arg, char **next)
 	if (!strncmp(arg, "tabstop=", 8))
 		return handle_switch_ftabstop(arg+8, next);
 
+	if (!strncmp(arg, "token-cache=", 12)) {
+		token_cache_dir = arg + 12;
+		return next;
+	}
+
 	if (!strcmp(arg, "unsigned-char")) {
 		funsigned_char = 1;
 		return next;
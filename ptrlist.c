@@ -6,6 +6,7 @@
  * (C) Copyright Linus Torvalds 2003-2005
  */
 #include <stdlib.h>
+#include <stddef.h>
 #include <string.h>
 #include <assert.h>
 
@@ -15,6 +16,31 @@
 
 __DECLARE_ALLOCATOR(struct ptr_list, ptrlist);
 __ALLOCATOR(struct ptr_list, "ptr list", ptrlist);
+__DECLARE_ALLOCATOR(struct ptr_list, small_ptrlist);
+__DO_ALLOCATOR(struct ptr_list, offsetof(struct ptr_list, list[SMALL_LIST_NODE_NR]),
+	       __alignof__(struct ptr_list), "small ptr list", small_ptrlist);
+
+static struct ptr_list *alloc_list_node(int small)
+{
+	struct ptr_list *node;
+
+	if (small) {
+		node = __alloc_small_ptrlist(0);
+		node->cap = SMALL_LIST_NODE_NR;
+	} else {
+		node = __alloc_ptrlist(0);
+		node->cap = LIST_NODE_NR;
+	}
+	return node;
+}
+
+static void free_list_node(struct ptr_list *node)
+{
+	if (node->cap == SMALL_LIST_NODE_NR)
+		__free_small_ptrlist(node);
+	else
+		__free_ptrlist(node);
+}
 
 int ptr_list_size(struct ptr_list *head)
 {
@@ -77,14 +103,14 @@ restart:
 			if (!entry->nr) {
 				struct ptr_list *prev;
 				if (next == entry) {
-					__free_ptrlist(entry);
+					free_list_node(entry);
 					*listp = NULL;
 					return;
 				}
 				prev = entry->prev;
 				prev->next = next;
 				next->prev = prev;
-				__free_ptrlist(entry);
+				free_list_node(entry);
 				if (entry == head) {
 					*listp = next;
 					head = next;
@@ -100,7 +126,7 @@ restart:
 void split_ptr_list_head(struct ptr_list *head)
 {
 	int old = head->nr, nr = old / 2;
-	struct ptr_list *newlist = __alloc_ptrlist(0);
+	struct ptr_list *newlist = alloc_list_node(0);
 	struct ptr_list *next = head->next;
 
 	old -= nr;
@@ -119,15 +145,19 @@ void **__add_ptr_list(struct ptr_list **listp, void *ptr, unsigned long tag)
 	struct ptr_list *list = *listp;
 	struct ptr_list *last = NULL; /* gcc complains needlessly */
 	void **ret;
-	int nr;
+	int nr = 0;
 
 	/* The low two bits are reserved for tags */
 	assert((3 & (unsigned long)ptr) == 0);
 	assert((~3 & tag) == 0);
 	ptr = (void *)(tag | (unsigned long)ptr);
 
-	if (!list || (nr = (last = list->prev)->nr) >= LIST_NODE_NR) {
-		struct ptr_list *newlist = __alloc_ptrlist(0);
+	if (list) {
+		last = list->prev;
+		nr = last->nr;
+	}
+	if (!list || nr >= last->cap) {
+		struct ptr_list *newlist = alloc_list_node(!list);
 		if (!list) {
 			newlist->next = newlist;
 			newlist->prev = newlist;
@@ -217,7 +247,7 @@ void * delete_ptr_list_last(struct ptr_list **head)
 		last->prev->next = first;
 		if (last == first)
 			*head = NULL;
-		__free_ptrlist(last);
+		free_list_node(last);
 	}
 	return ptr;
 }
@@ -241,7 +271,7 @@ void __free_ptr_list(struct ptr_list **listp)
 	while (list) {
 		tmp = list;
 		list = list->next;
-		__free_ptrlist(tmp);
+		free_list_node(tmp);
 	}
 
 	*listp = NULL;
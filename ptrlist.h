@@ -24,8 +24,16 @@
 
 #define LIST_NODE_NR (29)
 
+/*
+ * Most lists only ever hold one or two entries so the first node of a list
+ * is a small one which fits in a cache line.  The nodes after it are full
+ * size.
+ */
+#define SMALL_LIST_NODE_NR (5)
+
 struct ptr_list {
 	int nr;
+	int cap;
 	struct ptr_list *prev;
 	struct ptr_list *next;
 	void *list[LIST_NODE_NR];
@@ -233,7 +241,7 @@ extern void split_ptr_list_head(struct ptr_list *);
 
 #define DO_INSERT_CURRENT(new, ptr, __head, __list, __nr) do {				\
 	void **__this, **__last;							\
-	if (__list->nr == LIST_NODE_NR)							\
+	if (__list->nr == __list->cap)							\
 		DO_SPLIT(ptr, __head, __list, __nr);					\
 	__this = __list->list + __nr;							\
 	__last = __list->list + __list->nr - 1;						\
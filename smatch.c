@@ -19,6 +19,7 @@
 #include <unistd.h>
 #include <libgen.h>
 #include "smatch.h"
+#include "smatch_slist.h"
 #include "check_list.h"
 
 char *option_debug_check = (char *)"";
@@ -36,7 +37,19 @@ int option_enable = 0;
 int option_debug_related;
 int option_file_output;
 int option_time;
+int option_jobs;
+int option_mem_budget = 512;
+int option_max_possible = 1000;
+int option_build_db;
+int option_info_db;
+int option_merge_db;
+int option_update_db;
+int option_bench_stree;
+int option_profile;
+int option_huge_pages;
 char *option_datadir_str;
+char *option_server_str;
+char *option_compile_commands_str;
 FILE *sm_outfd;
 
 typedef void (*reg_func) (int id);
@@ -133,6 +146,19 @@ static void help(void)
 	printf("--assume-loops:  assume loops always go through at least once.\n");
 	printf("--two-passes:  use a two pass system for each function.\n");
 	printf("--file-output:  instead of printing stdout, print to \"file.c.smatch_out\".\n");
+	printf("--jobs=<n>:  analyze the functions in a file using n worker processes.\n");
+	printf("--mem-budget=<MB>:  memory a function can use before we start cutting corners.\n");
+	printf("--max-possible=<n>:  after n possible states, merge new ones into the old ones (0 means no limit).\n");
+	printf("--build-db <info file> <db file>:  build the cross function database from --info output.\n");
+	printf("--info-db:  like --info but write the info to \"file.c.smatch_db\".\n");
+	printf("--merge-db <db file> <file.c.smatch_db>...:  build the database from --info-db files.\n");
+	printf("--update-db <db file> <file.c.smatch_db>...:  replace the rows for some files and print the files to check again.\n");
+	printf("--bench-stree:  time the stree clone, insert, lookup and merge code.\n");
+	printf("--huge-pages:  put the per function memory in transparent huge pages.\n");
+	printf("--profile:  print how long each check's hooks take and save it to \"file.c.smatch_profile\".\n");
+	printf("--compile-commands=<file>:  check every file in a compile_commands.json.\n");
+	printf("--server=<socket>:  load everything once and check the files which --client sends.\n");
+	printf("--client=<socket> [args]:  (must be first) have the --server check the files.\n");
 	printf("--help:  print this helpful message.\n");
 	exit(1);
 }
@@ -200,6 +226,31 @@ void parse_args(int *argcp, char ***argvp)
 			(*argvp)[1] = (*argvp)[0];
 			found = 1;
 		}
+		if (!found && strncmp((*argvp)[1], "--jobs=", 7) == 0) {
+			option_jobs = atoi((*argvp)[1] + 7);
+			(*argvp)[1] = (*argvp)[0];
+			found = 1;
+		}
+		if (!found && strncmp((*argvp)[1], "--mem-budget=", 13) == 0) {
+			option_mem_budget = atoi((*argvp)[1] + 13);
+			(*argvp)[1] = (*argvp)[0];
+			found = 1;
+		}
+		if (!found && strncmp((*argvp)[1], "--max-possible=", 15) == 0) {
+			option_max_possible = atoi((*argvp)[1] + 15);
+			(*argvp)[1] = (*argvp)[0];
+			found = 1;
+		}
+		if (!found && strncmp((*argvp)[1], "--compile-commands=", 19) == 0) {
+			option_compile_commands_str = (*argvp)[1] + 19;
+			(*argvp)[1] = (*argvp)[0];
+			found = 1;
+		}
+		if (!found && strncmp((*argvp)[1], "--server=", 9) == 0) {
+			option_server_str = (*argvp)[1] + 9;
+			(*argvp)[1] = (*argvp)[0];
+			found = 1;
+		}
 		if (!found && strncmp((*argvp)[1], "--enable=", 9) == 0) {
 			enable_checks((*argvp)[1] + 9);
 			option_enable = 1;
@@ -221,6 +272,13 @@ void parse_args(int *argcp, char ***argvp)
 		OPTION(file_output);
 		OPTION(time);
 		OPTION(no_db);
+		OPTION(build_db);
+		OPTION(info_db);
+		OPTION(merge_db);
+		OPTION(update_db);
+		OPTION(bench_stree);
+		OPTION(profile);
+		OPTION(huge_pages);
 		if (!found)
 			break;
 		(*argcp)--;
@@ -231,6 +289,124 @@ void parse_args(int *argcp, char ***argvp)
 		option_project = PROJ_KERNEL;
 	if (!strcmp(option_project_str, "wine"))
 		option_project = PROJ_WINE;
+
+	if (option_info_db)
+		option_info = 1;
+}
+
+/*
+ * These are used before the checks are registered.  A --server only does
+ * that once so every client has to ask for the same thing.
+ */
+static struct {
+	const char *name;
+	int *val;
+	int saved;
+	int live;
+} startup_options[] = {
+	{ "--spammy", &option_spammy },
+	{ "--info", &option_info },
+	{ "--no-data", &option_no_data },
+	{ "--no-db", &option_no_db },
+	{ "--param-mapper", &option_param_mapper },
+	{ "--call-tree", &option_call_tree },
+	{ "--enable", &option_enable },
+};
+static char *saved_project_str;
+static char *saved_datadir_str;
+static int *saved_enabled;
+
+static int *save_enabled(void)
+{
+	int *enabled;
+	int i;
+
+	enabled = malloc(ARRAY_SIZE(reg_funcs) * sizeof(*enabled));
+	for (i = 0; i < ARRAY_SIZE(reg_funcs); i++)
+		enabled[i] = reg_funcs[i].enabled;
+	return enabled;
+}
+
+void save_startup_options(void)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(startup_options); i++)
+		startup_options[i].saved = *startup_options[i].val;
+	saved_project_str = option_project_str;
+	saved_datadir_str = option_datadir_str;
+	saved_enabled = save_enabled();
+}
+
+static int same_str(const char *one, const char *two)
+{
+	if (!one || !two)
+		return one == two;
+	return strcmp(one, two) == 0;
+}
+
+static const char *startup_option_mismatch(void)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(startup_options); i++) {
+		if (*startup_options[i].val != startup_options[i].saved)
+			return startup_options[i].name;
+	}
+	if (!same_str(option_project_str, saved_project_str))
+		return "--project";
+	if (!same_str(option_datadir_str, saved_datadir_str))
+		return "--data";
+	for (i = 0; i < ARRAY_SIZE(reg_funcs); i++) {
+		if (reg_funcs[i].enabled != saved_enabled[i])
+			return "--enable";
+	}
+	return NULL;
+}
+
+/*
+ * Parse a client's arguments starting from the defaults and check that
+ * they match what the server was started with.  The server's values are
+ * put back afterwards because setting up can change them, for example
+ * --no-db gets set if there is no database.  Returns the first option
+ * which doesn't match.
+ */
+const char *parse_client_args(int *argcp, char ***argvp)
+{
+	enum project_type project = option_project;
+	char *project_str = option_project_str;
+	char *datadir_str = option_datadir_str;
+	const char *mismatch;
+	int *enabled;
+	int i;
+
+	enabled = save_enabled();
+	for (i = 0; i < ARRAY_SIZE(startup_options); i++) {
+		startup_options[i].live = *startup_options[i].val;
+		*startup_options[i].val = 0;
+	}
+	option_info_db = 0;
+	option_project_str = (char *)"";
+	option_project = PROJ_NONE;
+	option_datadir_str = NULL;
+	for (i = 0; i < ARRAY_SIZE(reg_funcs); i++)
+		reg_funcs[i].enabled = 0;
+
+	parse_args(argcp, argvp);
+	mismatch = startup_option_mismatch();
+
+	for (i = 0; i < ARRAY_SIZE(startup_options); i++)
+		*startup_options[i].val = startup_options[i].live;
+	if (option_info_db)
+		option_info = 1;
+	option_project_str = project_str;
+	option_project = project;
+	option_datadir_str = datadir_str;
+	for (i = 0; i < ARRAY_SIZE(reg_funcs); i++)
+		reg_funcs[i].enabled = enabled[i];
+	free(enabled);
+
+	return mismatch;
 }
 
 static char *get_data_dir(char *arg0)
@@ -274,17 +450,31 @@ static char *get_data_dir(char *arg0)
 
 int main(int argc, char **argv)
 {
+	int ret;
 	int i;
 	reg_func func;
 
 	sm_outfd = stdout;
+	if (argc >= 2 && strncmp(argv[1], "--client=", 9) == 0)
+		return smatch_client(argv[1] + 9, argc - 2, argv + 2);
 	parse_args(&argc, &argv);
+	/* before open_smatch_db() and the checks change anything */
+	if (option_server_str)
+		save_startup_options();
 
 	/* this gets set back to zero when we parse the first function */
 	final_pass = 1;
 
 	data_dir = get_data_dir(argv[0]);
 
+	if (option_build_db)
+		return build_db(argc, argv);
+	if (option_merge_db)
+		return merge_db(argc, argv);
+	if (option_update_db)
+		return update_db(argc, argv);
+
+	function_arena.huge_pages = option_huge_pages;
 	allocate_hook_memory();
 	create_function_hook_hash();
 	open_smatch_db();
@@ -292,11 +482,21 @@ int main(int argc, char **argv)
 		func = reg_funcs[i].func;
 		/* The script IDs start at 1.
 		   0 is used for internal stuff. */
-		if (!option_enable || reg_funcs[i].enabled || !strncmp(reg_funcs[i].name, "register_", 9))
+		if (!option_enable || reg_funcs[i].enabled || !strncmp(reg_funcs[i].name, "register_", 9)) {
+			__set_hook_owner(i);
 			func(i);
+		}
 	}
+	__set_hook_owner(0);
 
-	smatch(argc, argv);
+	if (option_bench_stree)
+		return bench_stree();
+	if (option_server_str)
+		return smatch_server(option_server_str, argv[0]);
+	if (option_compile_commands_str)
+		return smatch_batch(option_compile_commands_str, argv[0], argc, argv);
+
+	ret = smatch(argc, argv);
 	free_string(data_dir);
-	return 0;
+	return ret;
 }
@@ -178,6 +178,7 @@ void add_indirect_modification_hook(int owner, modification_hook *call_back);
 void add_modification_hook_late(int owner, modification_hook *call_back);
 void add_indirect_modification_hook_late(int owner, modification_hook *call_back);
 struct smatch_state *get_modification_state(struct expression *expr);
+void modification_hook_stats(void);
 
 int outside_of_function(void);
 const char *get_filename(void);
@@ -310,6 +311,7 @@ int get_fuzzy_min(struct expression *expr, sval_t *min);
 int get_fuzzy_max(struct expression *expr, sval_t *max);
 int get_absolute_min(struct expression *expr, sval_t *sval);
 int get_absolute_max(struct expression *expr, sval_t *sval);
+void rl_cache_stats(int owner, unsigned long *hits, unsigned long *misses);
 int parse_call_math(struct expression *expr, char *math, sval_t *val);
 int parse_call_math_rl(struct expression *call, char *math, struct range_list **rl);
 char *get_value_in_terms_of_parameter_math(struct expression *expr);
@@ -325,6 +327,8 @@ int is_array(struct expression *expr);
 struct expression *get_array_base(struct expression *expr);
 struct expression *get_array_offset(struct expression *expr);
 const char *show_state(struct smatch_state *state);
+typedef const char *(state_name_fn)(struct smatch_state *state);
+const char *lazy_state_name(state_name_fn *fn);
 struct statement *get_expression_statement(struct expression *expr);
 struct expression *strip_parens(struct expression *expr);
 struct expression *strip_expr(struct expression *expr);
@@ -410,7 +414,8 @@ int in_condition(void);
 /* smatch_flow.c */
 
 extern int __in_fake_assign;
-void smatch (int argc, char **argv);
+extern int __fork_per_file;
+int smatch (int argc, char **argv);
 int inside_loop(void);
 int definitely_inside_loop(void);
 struct expression *get_switch_expr(void);
@@ -426,6 +431,15 @@ extern int option_two_passes;
 extern int option_no_db;
 extern int option_file_output;
 extern int option_time;
+extern int option_jobs;
+extern int option_mem_budget;
+extern int option_max_possible;
+extern int option_build_db;
+extern int option_info_db;
+extern int option_merge_db;
+extern int option_update_db;
+extern int option_profile;
+extern int option_huge_pages;
 extern struct expression_list *big_expression_stack;
 extern struct expression_list *big_condition_stack;
 extern struct statement_list *big_statement_stack;
@@ -464,6 +478,7 @@ struct stree *__implied_case_stree(struct expression *switch_expr,
 				   struct range_list_stack **remaining_cases,
 				   struct stree **raw_stree);
 void overwrite_states_using_pool(struct sm_state *gate_sm, struct sm_state *pool_sm);
+void implied_memo_stats(unsigned long *hits, unsigned long *misses);
 int assume(struct expression *expr);
 void end_assume(void);
 
@@ -644,6 +659,25 @@ struct smatch_state *__client_unmatched_state_function(struct sm_state *sm);
 void call_pre_merge_hook(struct sm_state *sm);
 void __push_scope_hooks(void);
 void __call_scope_hooks(void);
+void __set_hook_owner(int owner);
+int __get_hook_owner(void);
+
+/* smatch_profile.c */
+enum {
+	PROF_MERGE = NUM_HOOKS,
+	PROF_UNMATCHED,
+	PROF_SQL,
+	PROF_MEM_SQL,
+	PROF_SCOPE,
+	PROF_FUNCTION_HOOK,
+	PROF_NUM,
+};
+void __profile_push(int owner, int type);
+void __profile_pop(void);
+int __profile_owner(void);
+void __profile_start_function(void);
+void __profile_end_function(const char *name);
+void __profile_report(const char *file);
 
 /* smatch_function_hooks.c */
 void create_function_hook_hash(void);
@@ -705,6 +739,28 @@ enum info_type {
 
 void debug_sql(const char *sql);
 void debug_mem_sql(const char *sql);
+void sql_mem_insert(const char *table, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+void sql_mem_stats(void);
+void open_info_db(const char *file);
+void close_info_db(void);
+void sql_info_insert(const char *table, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+struct sqlite3;
+int load_db_schema(struct sqlite3 *db);
+
+/* smatch_server.c */
+int smatch_server(const char *path, char *progname);
+int smatch_client(const char *path, int argc, char **argv);
+
+/* smatch_batch.c */
+int smatch_batch(const char *compile_commands, char *progname, int argc, char **argv);
+
+/* smatch_bench.c */
+int bench_stree(void);
+
+/* smatch_build_db.c */
+int build_db(int argc, char **argv);
+int merge_db(int argc, char **argv);
+int update_db(int argc, char **argv);
 void select_caller_info_hook(void (*callback)(const char *name, struct symbol *sym, char *key, char *value), int type);
 void add_member_info_callback(int owner, void (*callback)(struct expression *call, int param, char *printed_name, struct sm_state *sm));
 void add_split_return_callback(void (*fn)(int return_id, char *return_ranges, struct expression *returned_expr));
@@ -757,6 +813,7 @@ void sql_insert_data_info(struct expression *data, int type, const char *value);
 
 void sql_select_return_states(const char *cols, struct expression *call,
 	int (*callback)(void*, int, char**, char**), void *info);
+void return_states_cache_stats(unsigned long *hits, unsigned long *misses);
 void sql_select_caller_info(const char *cols, struct symbol *sym,
 	int (*callback)(void*, int, char**, char**));
 void sql_select_call_implies(const char *cols, struct expression *call,
@@ -772,6 +829,9 @@ int open_data_file(const char *filename);
 struct token *get_tokens_file(const char *filename);
 
 /* smatch.c */
+void parse_args(int *argcp, char ***argvp);
+void save_startup_options(void);
+const char *parse_client_args(int *argcp, char ***argvp);
 extern char *option_debug_check;
 extern char *option_project_str;
 extern char *data_dir;
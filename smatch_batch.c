@@ -0,0 +1,443 @@
+/*
+ * Copyright (C) 2016 Oracle.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see http://www.gnu.org/copyleft/gpl.txt
+ */
+
+/*
+ * smatch -p=kernel --compile-commands=compile_commands.json [sparse args]
+ *
+ * Checks every file in a compile_commands.json with one command.  The
+ * smatch_data/ files, the database and the hooks are only loaded once.
+ *
+ * The files are grouped by directory and compiler flags.  Each group gets
+ * a child which calls sparse_initialize() once for the whole group and
+ * then forks again for each file so every file starts from the same clean
+ * state.  The -o, -c and dependency file flags are left out when comparing
+ * flags since they are different for every file.
+ */
+
+#include <ctype.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "smatch.h"
+
+struct cc_entry {
+	int idx;
+	char *directory;
+	char *file;
+	char *command;
+	char **args;
+	int nr_args;
+	char *key;
+	int has_file;
+};
+
+struct json {
+	char *p;
+	char *end;
+};
+
+static void add_arg(char ***args, int *nr, char *arg)
+{
+	if ((*nr & 15) == 0)
+		*args = realloc(*args, (*nr + 17) * sizeof(char *));
+	(*args)[(*nr)++] = arg;
+	(*args)[*nr] = NULL;
+}
+
+static void skip_space(struct json *js)
+{
+	while (js->p < js->end && isspace(*js->p))
+		js->p++;
+}
+
+static int json_expect(struct json *js, char c)
+{
+	skip_space(js);
+	if (js->p >= js->end || *js->p != c)
+		return 0;
+	js->p++;
+	return 1;
+}
+
+static void put_utf8(char **out, unsigned int c)
+{
+	char *o = *out;
+
+	if (c < 0x80) {
+		*o++ = c;
+	} else if (c < 0x800) {
+		*o++ = 0xc0 | (c >> 6);
+		*o++ = 0x80 | (c & 0x3f);
+	} else {
+		*o++ = 0xe0 | (c >> 12);
+		*o++ = 0x80 | ((c >> 6) & 0x3f);
+		*o++ = 0x80 | (c & 0x3f);
+	}
+	*out = o;
+}
+
+/* The string is unescaped in place.  The result is never longer. */
+static char *parse_string(struct json *js)
+{
+	char *start, *out;
+	unsigned int c;
+
+	if (!json_expect(js, '"'))
+		return NULL;
+	start = out = js->p;
+	while (js->p < js->end && *js->p != '"') {
+		if (*js->p != '\\') {
+			*out++ = *js->p++;
+			continue;
+		}
+		if (++js->p >= js->end)
+			return NULL;
+		switch (*js->p++) {
+		case 'b': *out++ = '\b'; break;
+		case 'f': *out++ = '\f'; break;
+		case 'n': *out++ = '\n'; break;
+		case 'r': *out++ = '\r'; break;
+		case 't': *out++ = '\t'; break;
+		case 'u':
+			if (js->end - js->p < 4 || sscanf(js->p, "%4x", &c) != 1)
+				return NULL;
+			js->p += 4;
+			put_utf8(&out, c);
+			break;
+		default:
+			*out++ = js->p[-1];
+		}
+	}
+	if (js->p >= js->end)
+		return NULL;
+	js->p++;
+	*out = '\0';
+	return start;
+}
+
+static int skip_value(struct json *js)
+{
+	char open, close;
+	int depth = 0;
+
+	skip_space(js);
+	if (js->p >= js->end)
+		return 0;
+	if (*js->p == '"')
+		return parse_string(js) != NULL;
+	if (*js->p != '[' && *js->p != '{') {
+		while (js->p < js->end && !strchr(",]} \t\r\n", *js->p))
+			js->p++;
+		return 1;
+	}
+	open = *js->p;
+	close = open == '[' ? ']' : '}';
+	while (js->p < js->end) {
+		if (*js->p == '"') {
+			if (!parse_string(js))
+				return 0;
+			continue;
+		}
+		if (*js->p == open)
+			depth++;
+		if (*js->p == close && --depth == 0) {
+			js->p++;
+			return 1;
+		}
+		js->p++;
+	}
+	return 0;
+}
+
+static int parse_arguments(struct json *js, struct cc_entry *entry)
+{
+	char *arg;
+
+	if (!json_expect(js, '['))
+		return 0;
+	if (json_expect(js, ']'))
+		return 1;
+	do {
+		arg = parse_string(js);
+		if (!arg)
+			return 0;
+		add_arg(&entry->args, &entry->nr_args, arg);
+	} while (json_expect(js, ','));
+	return json_expect(js, ']');
+}
+
+static int parse_entry(struct json *js, struct cc_entry *entry)
+{
+	char *key;
+
+	if (!json_expect(js, '{'))
+		return 0;
+	if (json_expect(js, '}'))
+		return 1;
+	do {
+		key = parse_string(js);
+		if (!key || !json_expect(js, ':'))
+			return 0;
+		if (strcmp(key, "directory") == 0)
+			entry->directory = parse_string(js);
+		else if (strcmp(key, "file") == 0)
+			entry->file = parse_string(js);
+		else if (strcmp(key, "command") == 0)
+			entry->command = parse_string(js);
+		else if (strcmp(key, "arguments") == 0) {
+			if (!parse_arguments(js, entry))
+				return 0;
+		} else if (!skip_value(js))
+			return 0;
+	} while (json_expect(js, ','));
+	return json_expect(js, '}');
+}
+
+/* Split a "command" the way the shell would, more or less. */
+static void split_command(struct cc_entry *entry)
+{
+	char *p = entry->command;
+	char *out, *arg;
+	char quote;
+
+	while (*p) {
+		while (isspace(*p))
+			p++;
+		if (!*p)
+			break;
+		arg = out = p;
+		quote = 0;
+		while (*p && (quote || !isspace(*p))) {
+			if (quote && *p == quote) {
+				quote = 0;
+				p++;
+			} else if (!quote && (*p == '"' || *p == '\'')) {
+				quote = *p++;
+			} else if (*p == '\\' && quote != '\'' && p[1]) {
+				p++;
+				*out++ = *p++;
+			} else {
+				*out++ = *p++;
+			}
+		}
+		if (*p)
+			p++;
+		*out = '\0';
+		add_arg(&entry->args, &entry->nr_args, arg);
+	}
+}
+
+static int is_source_file(struct cc_entry *entry, const char *arg)
+{
+	int len;
+
+	if (strcmp(arg, entry->file) == 0)
+		return 1;
+	/* "file" can be absolute when the command has it relative */
+	len = strlen(entry->directory);
+	if (strncmp(entry->file, entry->directory, len) == 0 &&
+	    entry->file[len] == '/' && strcmp(arg, entry->file + len + 1) == 0)
+		return 1;
+	return 0;
+}
+
+/*
+ * Leave out the compiler, the file and the flags that are different for
+ * every file.  The rest is what the file gets grouped by.
+ */
+static void filter_args(struct cc_entry *entry)
+{
+	char **args = NULL;
+	int nr = 0;
+	int len = strlen(entry->directory) + 1;
+	int i;
+
+	for (i = 1; i < entry->nr_args; i++) {
+		char *arg = entry->args[i];
+
+		if (!entry->has_file && is_source_file(entry, arg)) {
+			/* use the name the compiler sees so the warnings match */
+			entry->file = arg;
+			entry->has_file = 1;
+			continue;
+		}
+		if (strcmp(arg, "-c") == 0)
+			continue;
+		if (strcmp(arg, "-o") == 0 || strcmp(arg, "-MF") == 0 ||
+		    strcmp(arg, "-MT") == 0 || strcmp(arg, "-MQ") == 0) {
+			i++;
+			continue;
+		}
+		if (strncmp(arg, "-o", 2) == 0 || strncmp(arg, "-MF", 3) == 0 ||
+		    strncmp(arg, "-Wp,-MD,", 8) == 0 ||
+		    strncmp(arg, "-Wp,-MMD,", 9) == 0)
+			continue;
+		add_arg(&args, &nr, arg);
+		len += strlen(arg) + 1;
+	}
+	free(entry->args);
+	entry->args = args;
+	entry->nr_args = nr;
+
+	entry->key = malloc(len + 1);
+	strcpy(entry->key, entry->directory);
+	for (i = 0; i < nr; i++) {
+		strcat(entry->key, "\n");
+		strcat(entry->key, args[i]);
+	}
+}
+
+static int cmp_entries(const void *_a, const void *_b)
+{
+	const struct cc_entry *a = _a;
+	const struct cc_entry *b = _b;
+	int ret;
+
+	ret = strcmp(a->key, b->key);
+	if (ret)
+		return ret;
+	return a->idx - b->idx;
+}
+
+static char *read_file(const char *name, char **end)
+{
+	FILE *f;
+	char *buf = NULL;
+	size_t size = 0, len = 0, ret;
+
+	f = fopen(name, "r");
+	if (!f)
+		return NULL;
+	do {
+		if (len == size) {
+			size = size ? size * 2 : 65536;
+			buf = realloc(buf, size);
+		}
+		ret = fread(buf + len, 1, size - len, f);
+		len += ret;
+	} while (ret);
+	fclose(f);
+	*end = buf + len;
+	return buf;
+}
+
+static struct cc_entry *parse_compile_commands(const char *name, int *nr)
+{
+	struct cc_entry *entries = NULL;
+	struct json js;
+	int alloc = 0;
+
+	*nr = 0;
+	js.p = read_file(name, &js.end);
+	if (!js.p) {
+		fprintf(stderr, "smatch: cannot read %s\n", name);
+		*nr = -1;
+		return NULL;
+	}
+	if (!json_expect(&js, '['))
+		goto bad;
+	if (json_expect(&js, ']'))
+		return NULL;
+	do {
+		if (*nr == alloc) {
+			alloc = alloc ? alloc * 2 : 64;
+			entries = realloc(entries, alloc * sizeof(*entries));
+		}
+		memset(&entries[*nr], 0, sizeof(*entries));
+		entries[*nr].idx = *nr;
+		if (!parse_entry(&js, &entries[*nr]))
+			goto bad;
+		if (!entries[*nr].directory || !entries[*nr].file)
+			goto bad;
+		if (!entries[*nr].args && entries[*nr].command)
+			split_command(&entries[*nr]);
+		filter_args(&entries[*nr]);
+		(*nr)++;
+	} while (json_expect(&js, ','));
+	if (!json_expect(&js, ']'))
+		goto bad;
+	return entries;
+bad:
+	fprintf(stderr, "smatch: cannot parse %s (entry %d)\n", name, *nr + 1);
+	*nr = -1;
+	return NULL;
+}
+
+static void check_group(char *progname, int argc, char **argv,
+			struct cc_entry *entries, int nr)
+{
+	char **args = NULL;
+	int nr_args = 0;
+	int failed;
+	int i;
+
+	if (chdir(entries[0].directory)) {
+		fprintf(stderr, "smatch: cannot chdir to %s\n", entries[0].directory);
+		exit(1);
+	}
+
+	add_arg(&args, &nr_args, progname);
+	for (i = 1; i < argc; i++)
+		add_arg(&args, &nr_args, argv[i]);
+	for (i = 0; i < entries[0].nr_args; i++)
+		add_arg(&args, &nr_args, entries[0].args[i]);
+	for (i = 0; i < nr; i++)
+		add_arg(&args, &nr_args, entries[i].file);
+
+	__fork_per_file = 1;
+	failed = smatch(nr_args, args);
+	fflush(sm_outfd);
+	exit(failed ? 1 : 0);
+}
+
+int smatch_batch(const char *compile_commands, char *progname, int argc, char **argv)
+{
+	struct cc_entry *entries;
+	int nr, start, i;
+	int status;
+	int ret = 0;
+	pid_t pid;
+
+	entries = parse_compile_commands(compile_commands, &nr);
+	if (!entries)
+		return nr < 0;
+	qsort(entries, nr, sizeof(*entries), cmp_entries);
+
+	for (start = 0; start < nr; start = i) {
+		for (i = start + 1; i < nr; i++) {
+			if (strcmp(entries[i].key, entries[start].key) != 0)
+				break;
+		}
+
+		fflush(stdout);
+		fflush(stderr);
+		pid = fork();
+		if (pid < 0) {
+			fprintf(stderr, "smatch: fork: %s\n", strerror(errno));
+			return 1;
+		}
+		if (pid == 0)
+			check_group(progname, argc, argv, entries + start, i - start);
+		while (waitpid(pid, &status, 0) < 0) {
+			if (errno != EINTR)
+				return 1;
+		}
+		if (!WIFEXITED(status) || WEXITSTATUS(status))
+			ret = 1;
+	}
+	return ret;
+}
@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2016 Oracle.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see http://www.gnu.org/copyleft/gpl.txt
+ */
+
+/*
+ * smatch --bench-stree
+ *
+ * Times the stree operations that the flow code does the most: cloning an
+ * stree and changing one state in the copy, building an stree one insert
+ * at a time, looking states up and merging two copies of the same stree
+ * which differ in a few states.  Each one is done on strees of 100, 1000
+ * and 10000 states.  Nothing is random so the numbers can be compared
+ * between builds.
+ */
+
+#include <time.h>
+#include "smatch.h"
+#include "smatch_slist.h"
+
+#define BENCH_CHANGED 8
+
+/* any check without a merge function will do */
+static int bench_owner;
+static char **names;
+static struct smatch_state *states[6];
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+static void print_result(const char *what, int size, int ops, double start)
+{
+	double secs = now() - start;
+
+	printf("%-24s %5d states: %8.0f ns/op\n", what, size,
+	       secs * 1000000000.0 / ops);
+}
+
+/* free everything the way the end of a function does */
+static void reset_states(void)
+{
+	int i;
+
+	free_every_single_sm_state();
+	arena_release(&function_arena);
+	for (i = 0; i < ARRAY_SIZE(states); i++)
+		states[i] = alloc_state_num(i);
+}
+
+static struct stree *build_stree(int size)
+{
+	struct stree *stree = NULL;
+	int i;
+
+	for (i = 0; i < size; i++)
+		set_state_stree(&stree, bench_owner, names[i], NULL, states[i % 4]);
+	return stree;
+}
+
+static void bench_size(int size, int loops)
+{
+	struct stree *base, *one, *two;
+	double start;
+	int i, j;
+
+	reset_states();
+	start = now();
+	for (i = 0; i < loops / 10; i++) {
+		one = build_stree(size);
+		free_stree(&one);
+	}
+	print_result("insert", size, loops / 10 * size, start);
+
+	reset_states();
+	base = build_stree(size);
+
+	start = now();
+	for (i = 0; i < loops; i++) {
+		one = clone_stree(base);
+		set_state_stree(&one, bench_owner, names[(i * 7919) % size], NULL, states[4]);
+		free_stree(&one);
+	}
+	print_result("clone + one change", size, loops, start);
+
+	start = now();
+	for (i = 0; i < loops * 10; i++)
+		get_state_stree(base, bench_owner, names[(i * 7919) % size], NULL);
+	print_result("lookup", size, loops * 10, start);
+
+	start = now();
+	for (i = 0; i < loops; i++) {
+		one = clone_stree(base);
+		two = clone_stree(base);
+		for (j = 0; j < BENCH_CHANGED; j++) {
+			set_state_stree(&one, bench_owner, names[((i + j) * 7919) % size], NULL, states[4]);
+			set_state_stree(&two, bench_owner, names[((i + j) * 7919) % size], NULL, states[5]);
+		}
+		merge_stree_no_pools(&one, two);
+		free_stree(&one);
+		free_stree(&two);
+	}
+	print_result("merge, 8 changed", size, loops, start);
+
+	free_stree(&base);
+}
+
+int bench_stree(void)
+{
+	char buf[32];
+	int i;
+
+	for (bench_owner = 1; bench_owner <= num_checks; bench_owner++) {
+		if (!__has_merge_function(bench_owner))
+			break;
+	}
+
+	names = malloc(10000 * sizeof(*names));
+	for (i = 0; i < 10000; i++) {
+		snprintf(buf, sizeof(buf), "bench_var_%d", i);
+		names[i] = alloc_string(buf);
+	}
+	bench_size(100, 20000);
+	bench_size(1000, 5000);
+	bench_size(10000, 1000);
+	return 0;
+}
@@ -0,0 +1,1060 @@
+/*
+ * Copyright (C) 2016 Oracle.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see http://www.gnu.org/copyleft/gpl.txt
+ */
+
+/*
+ * This builds smatch_db.sqlite from the --info output.  It does the same
+ * thing as the fill_db_*.pl scripts and build_*_index.sh used to except that
+ * it only reads the warns file once.
+ *
+ * smatch --build-db -p=kernel smatch_warns.txt smatch_db.sqlite.new
+ *
+ * The "SQL: insert into ..." lines are parsed here and the values are bound
+ * to a prepared insert for the table.  If a line doesn't look like what
+ * Smatch prints then it's passed to sqlite3_exec() as it is.
+ *
+ * smatch --merge-db -p=kernel smatch_db.sqlite.new $(find -name \*.smatch_db)
+ *
+ * does the same thing for the per file databases that --info-db writes.
+ *
+ * smatch --update-db -p=kernel smatch_db.sqlite drivers/foo.c.smatch_db
+ *
+ * replaces the rows from drivers/foo.c in an existing database and prints
+ * the files which have to be checked again because of what changed.
+ */
+
+#include <ctype.h>
+#include <unistd.h>
+#include <sqlite3.h>
+#include "smatch.h"
+
+static sqlite3 *db;
+
+#define MAX_COLS 16
+
+struct table_insert {
+	char table[64];
+	int cols;
+	sqlite3_stmt *stmt;
+};
+static struct table_insert inserts[32];
+
+struct value {
+	const char *str;
+	int len;
+	int quoted;
+};
+
+static sqlite3_stmt *marker_stmt;
+static int call_id;
+static unsigned long rows;
+static struct string_list *common_funcs;
+
+static const char *early_indexes[] = {
+	"CREATE INDEX caller_fn_idx on caller_info (function, call_id);",
+	"CREATE INDEX caller_ff_idx on caller_info (file, function, call_id);",
+	"CREATE INDEX call_implies_fn_idx on call_implies (function);",
+	"CREATE INDEX call_implies_ff_idx on call_implies (file, function);",
+	"CREATE INDEX data_file_info_idx on data_info (file, data);",
+	"CREATE INDEX data_info_idx on data_info (data);",
+	"CREATE INDEX fn_ptr_idx_file on function_ptr (file, function);",
+	"CREATE INDEX fn_ptr_idx_nofile on function_ptr (function);",
+	"CREATE INDEX fn_ptr_idx_ptr on function_ptr (ptr);",
+	"CREATE INDEX file_function_type_info_idx on function_type_info (file, function);",
+	"CREATE INDEX function_type_info_idx on function_type_info (function);",
+	"CREATE INDEX function_type_size_idx ON function_type_size (type);",
+	"CREATE INDEX function_type_value_idx ON function_type_value (type);",
+	"CREATE INDEX local_value_idx on local_values (file, variable);",
+	"CREATE INDEX return_states_fn_idx on return_states (function);",
+	"CREATE INDEX return_states_ff_idx on return_states (file, function);",
+};
+
+static const char *late_indexes[] = {
+	"CREATE INDEX type_size_idx on type_size (type);",
+	"CREATE INDEX type_val_idx on type_value (type);",
+};
+
+static void exec_sql(const char *sql)
+{
+	char *err = NULL;
+	int rc;
+
+	rc = sqlite3_exec(db, sql, NULL, NULL, &err);
+	if (rc != SQLITE_OK) {
+		fprintf(stderr, "SQL error #2: %s\n", err);
+		fprintf(stderr, "SQL: '%s'\n", sql);
+		sqlite3_free(err);
+	}
+}
+
+static sqlite3_stmt *get_insert(const char *table, int len, int cols)
+{
+	char sql[256];
+	int pos, i, col;
+	int rc;
+
+	if (len >= sizeof(inserts[0].table))
+		return NULL;
+
+	for (i = 0; i < ARRAY_SIZE(inserts); i++) {
+		if (!inserts[i].stmt)
+			break;
+		if (inserts[i].cols == cols &&
+		    strncmp(inserts[i].table, table, len) == 0 &&
+		    inserts[i].table[len] == '\0')
+			return inserts[i].stmt;
+	}
+	if (i == ARRAY_SIZE(inserts))
+		return NULL;
+
+	pos = snprintf(sql, sizeof(sql), "insert into %.*s values (", len, table);
+	for (col = 0; col < cols; col++)
+		pos += snprintf(sql + pos, sizeof(sql) - pos, col ? ", ?" : "?");
+	snprintf(sql + pos, sizeof(sql) - pos, ");");
+
+	rc = sqlite3_prepare_v2(db, sql, -1, &inserts[i].stmt, NULL);
+	if (rc != SQLITE_OK) {
+		inserts[i].stmt = NULL;
+		return NULL;
+	}
+	snprintf(inserts[i].table, sizeof(inserts[i].table), "%.*s", len, table);
+	inserts[i].cols = cols;
+	return inserts[i].stmt;
+}
+
+static int is_number(const struct value *val)
+{
+	int i = 0;
+
+	if (val->len && val->str[0] == '-')
+		i++;
+	/* leave anything which might not fit in 64 bits to SQLite */
+	if (i == val->len || val->len - i > 18)
+		return 0;
+	for (; i < val->len; i++) {
+		if (!isdigit(val->str[i]))
+			return 0;
+	}
+	return 1;
+}
+
+/*
+ * Split "insert into table values ('a', 1, 'b');" up.  Smatch doesn't
+ * escape quotes so neither do we.
+ */
+static int parse_insert(const char *sql, const char **table, int *table_len,
+			struct value *vals, int *nr_vals)
+{
+	const char *p = sql;
+	int cols = 0;
+
+	while (*p == ' ')
+		p++;
+	if (strncmp(p, "insert into ", 12) != 0)
+		return 0;
+	p += 12;
+	*table = p;
+	while (isalnum(*p) || *p == '_')
+		p++;
+	*table_len = p - *table;
+	if (strncmp(p, " values (", 9) != 0)
+		return 0;
+	p += 9;
+
+	for (;;) {
+		while (*p == ' ')
+			p++;
+		if (cols == MAX_COLS)
+			return 0;
+		if (*p == '\'') {
+			vals[cols].str = ++p;
+			while (*p && *p != '\'')
+				p++;
+			if (!*p)
+				return 0;
+			vals[cols].len = p - vals[cols].str;
+			vals[cols].quoted = 1;
+			p++;
+		} else {
+			vals[cols].str = p;
+			while (*p && *p != ',' && *p != ')' && *p != ' ')
+				p++;
+			vals[cols].len = p - vals[cols].str;
+			vals[cols].quoted = 0;
+		}
+		cols++;
+		while (*p == ' ')
+			p++;
+		if (*p == ',') {
+			p++;
+			continue;
+		}
+		if (*p == ')')
+			break;
+		return 0;
+	}
+	p++;
+	if (*p == ';')
+		p++;
+	while (*p == ' ' || *p == '\n')
+		p++;
+	if (*p)
+		return 0;
+
+	*nr_vals = cols;
+	return 1;
+}
+
+static int value_is(const struct value *val, const char *str)
+{
+	return val->len == strlen(str) && strncmp(val->str, str, val->len) == 0;
+}
+
+static void exec_raw(const char *sql)
+{
+	char *buf, *p;
+
+	p = strstr(sql, "%CALL_ID%");
+	if (!p) {
+		exec_sql(sql);
+		return;
+	}
+	buf = malloc(strlen(sql) + 32);
+	snprintf(buf, strlen(sql) + 32, "%.*s%d%s", (int)(p - sql), sql,
+		 call_id, p + strlen("%CALL_ID%"));
+	exec_sql(buf);
+	free(buf);
+}
+
+static void insert_line(const char *sql, int caller_info)
+{
+	struct value vals[MAX_COLS];
+	sqlite3_stmt *stmt;
+	const char *table;
+	int table_len;
+	int marker = 0;
+	int cols;
+	int i;
+
+	if (!parse_insert(sql, &table, &table_len, vals, &cols)) {
+		exec_raw(sql);
+		return;
+	}
+	/* anything unusual gets left to SQLite */
+	for (i = 0; i < cols; i++) {
+		if (vals[i].quoted || is_number(&vals[i]) ||
+		    value_is(&vals[i], "%CALL_ID%") || value_is(&vals[i], "NULL"))
+			continue;
+		exec_raw(sql);
+		return;
+	}
+	stmt = get_insert(table, table_len, cols);
+	if (!stmt) {
+		exec_raw(sql);
+		return;
+	}
+
+	for (i = 0; i < cols; i++) {
+		if (!vals[i].quoted && value_is(&vals[i], "%CALL_ID%")) {
+			sqlite3_bind_int(stmt, i + 1, call_id);
+		} else if (vals[i].quoted && value_is(&vals[i], "%call_marker%")) {
+			/* don't need this taking space in the db. */
+			sqlite3_bind_text(stmt, i + 1, "", 0, SQLITE_STATIC);
+			marker = 1;
+		} else if (!vals[i].quoted && is_number(&vals[i])) {
+			sqlite3_bind_int64(stmt, i + 1, strtoll(vals[i].str, NULL, 10));
+		} else if (!vals[i].quoted && value_is(&vals[i], "NULL")) {
+			sqlite3_bind_null(stmt, i + 1);
+		} else {
+			sqlite3_bind_text(stmt, i + 1, vals[i].str, vals[i].len, SQLITE_STATIC);
+		}
+	}
+
+	if (sqlite3_step(stmt) != SQLITE_DONE) {
+		fprintf(stderr, "SQL error #2: %s\n", sqlite3_errmsg(db));
+		fprintf(stderr, "SQL: '%s'\n", sql);
+	}
+	sqlite3_reset(stmt);
+	rows++;
+
+	if (caller_info && marker && cols > 2) {
+		sqlite3_bind_text(marker_stmt, 1, vals[2].str, vals[2].len, SQLITE_STATIC);
+		sqlite3_step(marker_stmt);
+		sqlite3_reset(marker_stmt);
+		call_id++;
+	}
+}
+
+static const char *skip_callers[] = {
+	"printk", "memset", "memcpy", "kfree", "printf", "dev_err", "writel",
+};
+
+static int is_skipped_caller(const char *line)
+{
+	char fn[256];
+	const char *p;
+	char *tmp;
+	int len;
+	int i;
+
+	/* the function is the third quoted value */
+	p = line;
+	for (i = 0; i < 5; i++) {
+		p = strchr(p, '\'');
+		if (!p)
+			return 0;
+		p++;
+	}
+	len = strcspn(p, "'");
+	if (len >= sizeof(fn))
+		return 0;
+	snprintf(fn, sizeof(fn), "%.*s", len, p);
+
+	if (strstr(fn, "__builtin_"))
+		return 1;
+	for (i = 0; i < ARRAY_SIZE(skip_callers); i++) {
+		if (strcmp(fn, skip_callers[i]) == 0)
+			return 1;
+	}
+	FOR_EACH_PTR(common_funcs, tmp) {
+		if (strcmp(tmp, fn) == 0)
+			return 1;
+	} END_FOR_EACH_PTR(tmp);
+
+	return 0;
+}
+
+static void load_common_functions(void)
+{
+	char filename[256];
+	char buf[256];
+	char *func;
+	FILE *file;
+
+	snprintf(filename, sizeof(filename), "%s/%s.common_functions",
+		 data_dir, option_project_str);
+	file = fopen(filename, "r");
+	if (!file)
+		return;
+	while (fgets(buf, sizeof(buf), file)) {
+		buf[strcspn(buf, "\n")] = '\0';
+		func = alloc_string(buf);
+		add_ptr_list(&common_funcs, func);
+	}
+	fclose(file);
+}
+
+static void load_info_file(FILE *file)
+{
+	char *line = NULL;
+	size_t size = 0;
+	char *p;
+
+	while (getline(&line, &size, file) >= 0) {
+		p = strstr(line, "() SQL: ");
+		if (p) {
+			insert_line(p + strlen("() SQL: "), 0);
+			continue;
+		}
+		p = strstr(line, "() SQL_caller_info: ");
+		if (p) {
+			if (is_skipped_caller(p))
+				continue;
+			insert_line(p + strlen("() SQL_caller_info: "), 1);
+		}
+	}
+	free(line);
+}
+
+/*
+ * The call IDs are handed out as the rows are loaded so deleting the too
+ * common functions leaves gaps.  fill_db_caller_info.pl skipped those
+ * rows before numbering them so renumber the rest to match.
+ */
+static void renumber_call_ids(void)
+{
+	exec_sql("create temp table call_ids (new integer primary key, old integer);");
+	exec_sql("insert into call_ids (old) select distinct call_id from caller_info "
+		 "where caller != 'too common' order by call_id;");
+	exec_sql("create index temp.call_ids_old on call_ids (old);");
+	exec_sql("update caller_info set call_id = "
+		 "(select new - 1 from call_ids where old = caller_info.call_id) "
+		 "where caller != 'too common';");
+	exec_sql("drop table call_ids;");
+}
+
+/*
+ * Functions which are called from more than 200 places are not worth
+ * tracking.  Replace their caller_info with a "too common" marker.
+ */
+static void remove_too_common(void)
+{
+	char sql[1024];
+	char *fn;
+
+	exec_sql("create temp table too_common as select function from call_markers group by function having count(*) > 200;");
+	FOR_EACH_PTR(common_funcs, fn) {
+		snprintf(sql, sizeof(sql), "insert into too_common values ('%s');", fn);
+		exec_sql(sql);
+	} END_FOR_EACH_PTR(fn);
+	exec_sql("delete from caller_info where function in (select function from too_common);");
+	if (sqlite3_changes(db))
+		renumber_call_ids();
+	exec_sql("insert into caller_info select distinct 'unknown', 'too common', function, 0, 0, 0, -1, '', '' from too_common;");
+}
+
+/*
+ * The type_value and type_size tables hold the union of all the ranges
+ * in function_type_value and function_type_size.  The values can be
+ * anything from s64min to u64max so they're stored as a sign and a
+ * magnitude.
+ */
+struct num {
+	int neg;
+	unsigned long long val;
+};
+
+struct num_range {
+	struct num min, max;
+};
+
+static int text_to_num(const char *text, int len, unsigned long long u64max, struct num *ret)
+{
+	char buf[64];
+	char *p, *end;
+
+	snprintf(buf, sizeof(buf), "%.*s", len, text);
+	ret->neg = 0;
+
+	if (strstr(buf, "s64min")) {
+		ret->neg = 1;
+		ret->val = 1ULL << 63;
+		return 1;
+	} else if (strstr(buf, "s32min")) {
+		ret->neg = 1;
+		ret->val = 1ULL << 31;
+		return 1;
+	} else if (strstr(buf, "s16min")) {
+		ret->neg = 1;
+		ret->val = 1ULL << 15;
+		return 1;
+	} else if (strstr(buf, "s64max")) {
+		ret->val = (1ULL << 63) - 1;
+		return 1;
+	} else if (strstr(buf, "s32max")) {
+		ret->val = (1ULL << 31) - 1;
+		return 1;
+	} else if (strstr(buf, "s16max")) {
+		ret->val = (1ULL << 15) - 1;
+		return 1;
+	} else if (strstr(buf, "u64max")) {
+		ret->val = u64max;
+		return 1;
+	} else if (strstr(buf, "u32max")) {
+		ret->val = (1ULL << 32) - 1;
+		return 1;
+	} else if (strstr(buf, "u16max")) {
+		ret->val = (1ULL << 16) - 1;
+		return 1;
+	}
+
+	p = buf;
+	if ((p = strchr(buf, '('))) {
+		p++;
+		end = strchr(p, ')');
+		if (end)
+			*end = '\0';
+	} else {
+		p = buf;
+	}
+	if (*p != '-' && !isdigit(*p))
+		return 0;
+	if (*p == '-') {
+		ret->neg = 1;
+		p++;
+	}
+	ret->val = strtoull(p, NULL, 10);
+	if (ret->val == 0)
+		ret->neg = 0;
+	return 1;
+}
+
+static int cmp_num(struct num a, struct num b)
+{
+	if (a.neg != b.neg)
+		return a.neg ? -1 : 1;
+	if (a.val == b.val)
+		return 0;
+	if (a.neg)
+		return a.val > b.val ? -1 : 1;
+	return a.val < b.val ? -1 : 1;
+}
+
+static void add_num_range(struct num_range **ranges, int *count, struct num min, struct num max)
+{
+	struct num_range *old = *ranges;
+	struct num_range *new;
+	struct num_range range = { min, max };
+	int added = 0;
+	int cnt = 0;
+	int i;
+
+	new = malloc((*count + 1) * sizeof(*new));
+	for (i = 0; i < *count; i++) {
+		if (added) {
+			new[cnt++] = old[i];
+			continue;
+		}
+		if (cmp_num(range.max, old[i].min) < 0) {
+			new[cnt++] = range;
+			new[cnt++] = old[i];
+			added = 1;
+		} else if (cmp_num(range.min, old[i].min) <= 0) {
+			if (cmp_num(range.max, old[i].max) <= 0) {
+				range.max = old[i].max;
+				new[cnt++] = range;
+				added = 1;
+			}
+		} else if (cmp_num(range.min, old[i].max) <= 0) {
+			if (cmp_num(range.max, old[i].max) <= 0) {
+				new[cnt++] = old[i];
+				added = 1;
+			} else {
+				range.min = old[i].min;
+			}
+		} else {
+			new[cnt++] = old[i];
+		}
+	}
+	if (!added)
+		new[cnt++] = range;
+
+	free(old);
+	*ranges = new;
+	*count = cnt;
+}
+
+static int print_num(char *buf, int size, struct num num)
+{
+	if (num.neg)
+		return snprintf(buf, size, "(-%llu)", num.val);
+	return snprintf(buf, size, "%llu", num.val);
+}
+
+static char *ranges_to_str(struct num_range *ranges, int count)
+{
+	static char buf[4096];
+	int pos = 0;
+	int i;
+
+	buf[0] = '\0';
+	for (i = 0; i < count && pos < sizeof(buf); i++) {
+		if (i)
+			pos += snprintf(buf + pos, sizeof(buf) - pos, ",");
+		if (pos >= sizeof(buf))
+			break;
+		pos += print_num(buf + pos, sizeof(buf) - pos, ranges[i].min);
+		if (cmp_num(ranges[i].min, ranges[i].max) == 0 || pos >= sizeof(buf))
+			continue;
+		pos += snprintf(buf + pos, sizeof(buf) - pos, "-");
+		if (pos >= sizeof(buf))
+			break;
+		pos += print_num(buf + pos, sizeof(buf) - pos, ranges[i].max);
+	}
+	return buf;
+}
+
+/*
+ * Ranges look like "0-10" or "(-5)-(-1)".  The split is on the last '-'
+ * which isn't a negative sign.
+ */
+static int parse_range(const char *text, int len, unsigned long long u64max,
+		       struct num *min, struct num *max)
+{
+	int i;
+
+	for (i = len - 1; i > 0; i--) {
+		if (text[i] == '-' && text[i - 1] != '(')
+			break;
+	}
+	if (i > 0) {
+		if (!text_to_num(text, i, u64max, min))
+			return 0;
+		return text_to_num(text + i + 1, len - i - 1, u64max, max);
+	}
+	if (!text_to_num(text, len, u64max, min))
+		return 0;
+	*max = *min;
+	return 1;
+}
+
+static int is_ignore(const char *text, int len)
+{
+	char buf[64];
+
+	snprintf(buf, sizeof(buf), "%.*s", len, text);
+	return !!strstr(buf, "ignore");
+}
+
+/*
+ * type_value and type_size are built slightly differently.  For type_value
+ * "ignore" ranges are skipped and it gives up on a type as soon as it finds
+ * something it can't parse.  It also skips types with more than 100 ranges.
+ * For type_size u64max is (1 << 62) - 1.  This is all how the Perl scripts
+ * did it.
+ */
+static void build_type_table(const char *from, const char *col, const char *to, int is_value)
+{
+	unsigned long long u64max = is_value ? ~0ULL : (1ULL << 62) - 1;
+	struct num_range *ranges = NULL;
+	struct num min, max;
+	char sql[256];
+	sqlite3_stmt *select, *insert;
+	char *cur_type = NULL;
+	const char *type, *value, *p;
+	int count = 0;
+	int skip = 0;
+	int len;
+
+	snprintf(sql, sizeof(sql), "select type, %s from %s order by type;", col, from);
+	if (sqlite3_prepare_v2(db, sql, -1, &select, NULL) != SQLITE_OK)
+		return;
+	snprintf(sql, sizeof(sql), "insert into %s values (?, ?);", to);
+	if (sqlite3_prepare_v2(db, sql, -1, &insert, NULL) != SQLITE_OK) {
+		sqlite3_finalize(select);
+		return;
+	}
+
+	for (;;) {
+		int done = sqlite3_step(select) != SQLITE_ROW;
+
+		type = done ? NULL : (const char *)sqlite3_column_text(select, 0);
+		if (!type)
+			type = "";
+
+		if (done || !cur_type || strcmp(cur_type, type) != 0) {
+			if (cur_type && !skip) {
+				if (is_value && count > 101) {
+					printf("%s %d\n", cur_type, count);
+				} else {
+					sqlite3_bind_text(insert, 1, cur_type, -1, SQLITE_STATIC);
+					sqlite3_bind_text(insert, 2, ranges_to_str(ranges, count), -1, SQLITE_STATIC);
+					sqlite3_step(insert);
+					sqlite3_reset(insert);
+				}
+			}
+			if (done)
+				break;
+			free(cur_type);
+			cur_type = strdup(type);
+			free(ranges);
+			ranges = NULL;
+			count = 0;
+			skip = 0;
+		}
+
+		if (skip)
+			continue;
+
+		value = (const char *)sqlite3_column_text(select, 1);
+		if (!value)
+			value = "";
+		/* like Perl's split(), trailing empty ranges are dropped */
+		len = strlen(value);
+		while (len && value[len - 1] == ',')
+			len--;
+		p = value;
+		while (p < value + len) {
+			int range_len = strcspn(p, ",");
+
+			if (range_len > value + len - p)
+				range_len = value + len - p;
+
+			if (is_value && is_ignore(p, range_len))
+				goto next;
+			if (!parse_range(p, range_len, u64max, &min, &max)) {
+				skip = 1;
+				break;
+			}
+			add_num_range(&ranges, &count, min, max);
+next:
+			p += range_len + 1;
+		}
+	}
+
+	free(cur_type);
+	free(ranges);
+	sqlite3_finalize(select);
+	sqlite3_finalize(insert);
+}
+
+static void create_indexes(const char **indexes, int nr)
+{
+	int i;
+
+	for (i = 0; i < nr; i++)
+		exec_sql(indexes[i]);
+}
+
+static int create_db(const char *db_file)
+{
+	unlink(db_file);
+	if (sqlite3_open(db_file, &db) != SQLITE_OK) {
+		printf("Error:  Cannot create %s\n", db_file);
+		return 0;
+	}
+	if (!load_db_schema(db)) {
+		printf("Error:  Cannot find the database schema files\n");
+		return 0;
+	}
+
+	exec_sql("PRAGMA synchronous = OFF;");
+	exec_sql("PRAGMA cache_size = 800000;");
+	exec_sql("PRAGMA journal_mode = OFF;");
+	exec_sql("PRAGMA temp_store = MEMORY;");
+	exec_sql("create temp table call_markers (function varchar(64));");
+	sqlite3_prepare_v2(db, "insert into call_markers values (?);", -1, &marker_stmt, NULL);
+
+	load_common_functions();
+	return 1;
+}
+
+static void finish_db(void)
+{
+	int i;
+
+	remove_too_common();
+	exec_sql("commit;");
+
+	create_indexes(early_indexes, ARRAY_SIZE(early_indexes));
+
+	exec_sql("begin;");
+	build_type_table("function_type_value", "value", "type_value", 1);
+	build_type_table("function_type_size", "size", "type_size", 0);
+	exec_sql("commit;");
+
+	create_indexes(late_indexes, ARRAY_SIZE(late_indexes));
+
+	for (i = 0; i < ARRAY_SIZE(inserts); i++) {
+		if (inserts[i].stmt)
+			sqlite3_finalize(inserts[i].stmt);
+	}
+	sqlite3_finalize(marker_stmt);
+	sqlite3_close(db);
+}
+
+int build_db(int argc, char **argv)
+{
+	struct timeval start, stop;
+	const char *info_file, *db_file;
+	FILE *file;
+
+	if (argc < 3) {
+		printf("Usage:  smatch --build-db -p=<project> <file with smatch messages> <db file>\n");
+		return 1;
+	}
+	info_file = argv[1];
+	db_file = argv[2];
+
+	gettimeofday(&start, NULL);
+
+	file = fopen(info_file, "r");
+	if (!file) {
+		printf("Error:  Cannot open %s\n", info_file);
+		return 1;
+	}
+
+	if (!create_db(db_file))
+		return 1;
+	/* only one process is allowed to look at the db while we build it */
+	exec_sql("PRAGMA locking_mode = EXCLUSIVE;");
+
+	exec_sql("begin;");
+	load_info_file(file);
+	fclose(file);
+	finish_db();
+
+	gettimeofday(&stop, NULL);
+	if (option_time)
+		printf("%lu rows in %lu seconds\n", rows, stop.tv_sec - start.tv_sec);
+	return 0;
+}
+
+static int get_int(const char *sql)
+{
+	sqlite3_stmt *stmt;
+	int ret = 0;
+
+	if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+		fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(db));
+		return 0;
+	}
+	if (sqlite3_step(stmt) == SQLITE_ROW)
+		ret = sqlite3_column_int(stmt, 0);
+	sqlite3_finalize(stmt);
+	return ret;
+}
+
+static void fill_skip_funcs(void)
+{
+	char sql[256];
+	char *fn;
+	int i;
+
+	exec_sql("create temp table skip_funcs (function varchar(64));");
+	for (i = 0; i < ARRAY_SIZE(skip_callers); i++) {
+		snprintf(sql, sizeof(sql), "insert into skip_funcs values ('%s');", skip_callers[i]);
+		exec_sql(sql);
+	}
+	FOR_EACH_PTR(common_funcs, fn) {
+		snprintf(sql, sizeof(sql), "insert into skip_funcs values ('%s');", fn);
+		exec_sql(sql);
+	} END_FOR_EACH_PTR(fn);
+}
+
+/*
+ * The call IDs in each file start at zero so they are moved up past the
+ * IDs that are already in the database.
+ */
+static void merge_caller_info(void)
+{
+	char sql[1024];
+	int offset = call_id;
+
+	exec_sql("create temp table shard_callers as select * from shard.caller_info "
+		 "where instr(function, '__builtin_') = 0 and "
+		 "function not in (select function from skip_funcs);");
+	exec_sql("insert into call_markers select function from shard_callers "
+		 "where key = '%call_marker%';");
+	snprintf(sql, sizeof(sql),
+		 "insert into caller_info select file, caller, function, call_id + %d, "
+		 "static, type, parameter, "
+		 "case when key = '%%call_marker%%' then '' else key end, value "
+		 "from shard_callers;", offset);
+	exec_sql(sql);
+	call_id = offset + get_int("select max(call_id) + 1 from shard_callers;");
+	rows += get_int("select count(*) from shard_callers;");
+	exec_sql("drop table shard_callers;");
+}
+
+/*
+ * The rows which depend on other files.  call_id is left out because it's
+ * different every time.
+ */
+#define RETURN_COLS "file, function, return_id, return, static, type, parameter, key, value"
+#define CALLER_COLS "file, caller, function, static, type, parameter, key, value"
+
+/*
+ * The file name comes from the shard's shard_file table and not from the
+ * rows in the shard because a file which doesn't have any rows now still
+ * has to have its old rows deleted.
+ */
+static int delete_old_rows(const char *shard_file, struct string_list *tables)
+{
+	char sql[1024];
+	char *table;
+
+	if (get_int("select count(*) from shard.sqlite_master "
+		    "where type = 'table' and name = 'shard_file';") != 1 ||
+	    get_int("select count(*) from shard.shard_file;") != 1) {
+		fprintf(stderr, "Error:  %s doesn't say which file it is for\n", shard_file);
+		return 0;
+	}
+
+	exec_sql("create temp table shard_files as select file from shard.shard_file;");
+	exec_sql("create temp table old_returns as select " RETURN_COLS " from return_states "
+		 "where file in (select file from shard_files);");
+	exec_sql("create temp table old_callers as select " CALLER_COLS " from caller_info "
+		 "where file in (select file from shard_files);");
+
+	FOR_EACH_PTR(tables, table) {
+		/* type_value and type_size are rebuilt at the end */
+		if (strncmp(table, "type_", 5) == 0)
+			continue;
+		snprintf(sql, sizeof(sql),
+			 "delete from main.%s where file in (select file from shard_files);",
+			 table);
+		exec_sql(sql);
+	} END_FOR_EACH_PTR(table);
+	return 1;
+}
+
+static void record_changed_files(void)
+{
+	exec_sql("insert into changed_files select file from ("
+		 "select " RETURN_COLS " from old_returns except "
+		 "select " RETURN_COLS " from return_states where file in (select file from shard_files) "
+		 "union "
+		 "select " RETURN_COLS " from return_states where file in (select file from shard_files) except "
+		 "select " RETURN_COLS " from old_returns);");
+	exec_sql("insert into changed_files select file from ("
+		 "select " CALLER_COLS " from old_callers except "
+		 "select " CALLER_COLS " from caller_info where file in (select file from shard_files) "
+		 "union "
+		 "select " CALLER_COLS " from caller_info where file in (select file from shard_files) except "
+		 "select " CALLER_COLS " from old_callers);");
+
+	exec_sql("drop table old_returns;");
+	exec_sql("drop table old_callers;");
+	exec_sql("drop table shard_files;");
+}
+
+static void merge_shard(const char *shard_file, int replace)
+{
+	struct string_list *tables = NULL;
+	sqlite3_stmt *stmt;
+	char sql[1024];
+	char *attach;
+	char *table;
+
+	attach = sqlite3_mprintf("attach database %Q as shard;", shard_file);
+	exec_sql(attach);
+	sqlite3_free(attach);
+
+	sqlite3_prepare_v2(db, "select name from shard.sqlite_master where type = 'table';",
+			   -1, &stmt, NULL);
+	while (sqlite3_step(stmt) == SQLITE_ROW) {
+		/* shard_file is only used by delete_old_rows() */
+		if (strcmp((const char *)sqlite3_column_text(stmt, 0), "shard_file") == 0)
+			continue;
+		table = alloc_string((const char *)sqlite3_column_text(stmt, 0));
+		add_ptr_list(&tables, table);
+	}
+	sqlite3_finalize(stmt);
+
+	exec_sql("begin;");
+	if (replace && !delete_old_rows(shard_file, tables)) {
+		exec_sql("rollback;");
+		goto detach;
+	}
+	FOR_EACH_PTR(tables, table) {
+		if (strcmp(table, "caller_info") == 0) {
+			merge_caller_info();
+			continue;
+		}
+		snprintf(sql, sizeof(sql),
+			 "insert into main.%s select * from shard.%s;", table, table);
+		exec_sql(sql);
+		rows += sqlite3_changes(db);
+	} END_FOR_EACH_PTR(table);
+	if (replace)
+		record_changed_files();
+	exec_sql("commit;");
+detach:
+	exec_sql("detach database shard;");
+
+	FOR_EACH_PTR(tables, table) {
+		free_string(table);
+	} END_FOR_EACH_PTR(table);
+	__free_ptr_list((struct ptr_list **)&tables);
+}
+
+int merge_db(int argc, char **argv)
+{
+	struct timeval start, stop;
+	int i;
+
+	if (argc < 3) {
+		printf("Usage:  smatch --merge-db -p=<project> <db file> <file.c.smatch_db>...\n");
+		return 1;
+	}
+
+	gettimeofday(&start, NULL);
+
+	if (!create_db(argv[1]))
+		return 1;
+	fill_skip_funcs();
+
+	for (i = 2; i < argc; i++)
+		merge_shard(argv[i], 0);
+
+	exec_sql("begin;");
+	finish_db();
+
+	gettimeofday(&stop, NULL);
+	if (option_time)
+		printf("%lu rows from %d files in %lu seconds\n", rows, argc - 2,
+		       stop.tv_sec - start.tv_sec);
+	return 0;
+}
+
+/*
+ * If the return_states for a file changed then the callers of its
+ * functions have to be checked again.  If the caller_info changed then
+ * the functions which it calls have to be checked again.
+ */
+static void print_dependent_files(void)
+{
+	sqlite3_stmt *stmt;
+
+	sqlite3_prepare_v2(db,
+		"select file from caller_info where file != 'unknown' and function in "
+		"(select function from return_states where file in (select file from changed_files)) "
+		"union "
+		"select file from return_states where function in "
+		"(select function from caller_info where file in (select file from changed_files));",
+		-1, &stmt, NULL);
+	while (sqlite3_step(stmt) == SQLITE_ROW)
+		printf("%s\n", sqlite3_column_text(stmt, 0));
+	sqlite3_finalize(stmt);
+}
+
+int update_db(int argc, char **argv)
+{
+	const char *db_file;
+	int i;
+
+	if (argc < 3) {
+		printf("Usage:  smatch --update-db -p=<project> <db file> <file.c.smatch_db>...\n");
+		return 1;
+	}
+	db_file = argv[1];
+
+	if (sqlite3_open_v2(db_file, &db, SQLITE_OPEN_READWRITE, NULL) != SQLITE_OK) {
+		printf("Error:  Cannot open %s\n", db_file);
+		return 1;
+	}
+	exec_sql("PRAGMA synchronous = OFF;");
+	exec_sql("PRAGMA journal_mode = OFF;");
+	exec_sql("PRAGMA temp_store = MEMORY;");
+	exec_sql("create temp table call_markers (function varchar(64));");
+	exec_sql("create temp table changed_files (file varchar(128));");
+	load_common_functions();
+	fill_skip_funcs();
+	call_id = get_int("select max(call_id) + 1 from caller_info;");
+
+	for (i = 2; i < argc; i++)
+		merge_shard(argv[i], 1);
+
+	exec_sql("begin;");
+	/* functions which were too common before still are */
+	exec_sql("delete from caller_info where file != 'unknown' and function in "
+		 "(select function from caller_info where file = 'unknown' and caller = 'too common');");
+	exec_sql("delete from type_value;");
+	exec_sql("delete from type_size;");
+	build_type_table("function_type_value", "value", "type_value", 1);
+	build_type_table("function_type_size", "size", "type_size", 0);
+	exec_sql("commit;");
+
+	print_dependent_files();
+
+	for (i = 0; i < ARRAY_SIZE(inserts); i++) {
+		if (inserts[i].stmt)
+			sqlite3_finalize(inserts[i].stmt);
+	}
+	sqlite3_close(db);
+	return 0;
+}
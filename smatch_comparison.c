@@ -41,7 +41,7 @@ static int inc_dec_link_id;
 STATE(start);
 STATE(incremented);
 
-ALLOCATOR(compare_data, "compare data");
+ARENA_ALLOCATOR(compare_data, "compare data", &function_arena, NULL);
 
 static struct symbol *vsl_to_sym(struct var_sym_list *vsl)
 {
@@ -55,6 +55,105 @@ static struct symbol *vsl_to_sym(struct var_sym_list *vsl)
 	return vs->sym;
 }
 
+/*
+ * Compare states never change after they are allocated so we only keep one
+ * copy of each.  That way when the same comparison gets merged with itself
+ * merge_states() sees the same pointer and doesn't call the merge hook.  The
+ * table is cleared when the compare_data is freed at the end of the function.
+ */
+static const char *compare_name;
+static struct smatch_state **compare_states;
+static int compare_states_size;
+static int compare_states_used;
+
+static unsigned int compare_hash(const char *var1, int comparison, const char *var2)
+{
+	unsigned int hash = 5381 + comparison;
+
+	while (*var1)
+		hash = hash * 33 + (unsigned char)*var1++;
+	while (*var2)
+		hash = hash * 33 + (unsigned char)*var2++;
+	return hash;
+}
+
+static int vsl_equiv(struct var_sym_list *one, struct var_sym_list *two)
+{
+	struct var_sym *one_vs, *two_vs;
+
+	PREPARE_PTR_LIST(one, one_vs);
+	PREPARE_PTR_LIST(two, two_vs);
+	for (;;) {
+		if (!one_vs && !two_vs)
+			return 1;
+		if (!one_vs || !two_vs)
+			return 0;
+		if (one_vs->sym != two_vs->sym || strcmp(one_vs->var, two_vs->var) != 0)
+			return 0;
+		NEXT_PTR_LIST(one_vs);
+		NEXT_PTR_LIST(two_vs);
+	}
+	FINISH_PTR_LIST(two_vs);
+	FINISH_PTR_LIST(one_vs);
+
+	return 1;
+}
+
+static int compare_state_matches(struct smatch_state *state,
+		const char *var1, struct var_sym_list *vsl1,
+		int comparison,
+		const char *var2, struct var_sym_list *vsl2)
+{
+	struct compare_data *data = state->data;
+
+	return data->comparison == comparison &&
+	       strcmp(data->var1, var1) == 0 &&
+	       strcmp(data->var2, var2) == 0 &&
+	       vsl_equiv(data->vsl1, vsl1) &&
+	       vsl_equiv(data->vsl2, vsl2);
+}
+
+static void add_compare_state(struct smatch_state *state)
+{
+	struct compare_data *data = state->data;
+	unsigned int h;
+
+	h = compare_hash(data->var1, data->comparison, data->var2) & (compare_states_size - 1);
+	while (compare_states[h])
+		h = (h + 1) & (compare_states_size - 1);
+	compare_states[h] = state;
+	compare_states_used++;
+}
+
+static void grow_compare_states(void)
+{
+	struct smatch_state **old = compare_states;
+	int old_size = compare_states_size;
+	int i;
+
+	compare_states_size = old_size ? old_size * 2 : 1024;
+	compare_states = calloc(compare_states_size, sizeof(*compare_states));
+	compare_states_used = 0;
+	for (i = 0; i < old_size; i++) {
+		if (old[i])
+			add_compare_state(old[i]);
+	}
+	free(old);
+}
+
+static void clear_compare_states(void)
+{
+	if (!compare_states_used)
+		return;
+	memset(compare_states, 0, compare_states_size * sizeof(*compare_states));
+	compare_states_used = 0;
+}
+
+static const char *show_compare_state(struct smatch_state *state)
+{
+	return alloc_sname(show_special(state_to_comparison(state)));
+}
+
 struct smatch_state *alloc_compare_state(
 		const char *var1, struct var_sym_list *vsl1,
 		int comparison,
@@ -62,9 +161,19 @@ struct smatch_state *alloc_compare_state(
 {
 	struct smatch_state *state;
 	struct compare_data *data;
+	unsigned int h;
+
+	if (compare_states_used * 2 >= compare_states_size)
+		grow_compare_states();
+
+	h = compare_hash(var1, comparison, var2) & (compare_states_size - 1);
+	for (; compare_states[h]; h = (h + 1) & (compare_states_size - 1)) {
+		if (compare_state_matches(compare_states[h], var1, vsl1, comparison, var2, vsl2))
+			return compare_states[h];
+	}
 
 	state = __alloc_smatch_state(0);
-	state->name = alloc_sname(show_special(comparison));
+	state->name = compare_name;
 	data = __alloc_compare_data(0);
 	data->var1 = alloc_sname(var1);
 	data->vsl1 = clone_var_sym_list(vsl1);
@@ -72,6 +181,9 @@ struct smatch_state *alloc_compare_state(
 	data->var2 = alloc_sname(var2);
 	data->vsl2 = clone_var_sym_list(vsl2);
 	state->data = data;
+
+	compare_states[h] = state;
+	compare_states_used++;
 	return state;
 }
 
@@ -1416,9 +1528,9 @@ struct state_list *get_all_possible_equal_comparisons(struct expression *expr)
 		sm = get_sm_state(compare_id, tmp, NULL);
 		if (!sm)
 			continue;
-		if (!strchr(sm->state->name, '='))
+		if (!strchr(show_state(sm->state), '='))
 			continue;
-		if (strcmp(sm->state->name, "!=") == 0)
+		if (strcmp(show_state(sm->state), "!=") == 0)
 			continue;
 		add_ptr_list(&ret, sm);
 	} END_FOR_EACH_PTR(tmp);
@@ -2041,12 +2153,13 @@ static void free_data(struct symbol *sym)
 {
 	if (__inline_fn)
 		return;
-	clear_compare_data_alloc();
+	clear_compare_states();
 }
 
 void register_comparison(int id)
 {
 	compare_id = id;
+	compare_name = lazy_state_name(&show_compare_state);
 	add_hook(&save_start_states, AFTER_DEF_HOOK);
 	add_unmatched_state_hook(compare_id, unmatched_comparison);
 	add_merge_hook(compare_id, &merge_compare_states);
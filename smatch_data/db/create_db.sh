@@ -1,33 +1,39 @@
 #!/bin/bash
 
-if echo $1 | grep -q '^-p' ; then
-    PROJ=$(echo $1 | cut -d = -f 2)
-    shift
-fi
+# The smatch binary comes from $PATH unless --smatch=<binary> is used.
+SMATCH=smatch
+
+while true ; do
+    if echo $1 | grep -q '^-p' ; then
+        PROJ=$(echo $1 | cut -d = -f 2)
+        shift
+    elif echo $1 | grep -q '^--smatch=' ; then
+        SMATCH=$(echo $1 | cut -d = -f 2-)
+        shift
+    else
+        break
+    fi
+done
 
 info_file=$1
 
 if [[ "$info_file" = "" ]] ; then
-    echo "Usage:  $0 -p=<project> <file with smatch messages>"
+    echo "Usage:  $0 [--smatch=<binary>] -p=<project> <file with smatch messages>"
+    echo "        $0 [--smatch=<binary>] -p=<project> <file.c.smatch_db>..."
     exit 1
 fi
 
 bin_dir=$(dirname $0)
 db_file=smatch_db.sqlite.new
 
-rm -f $db_file
-
-for i in ${bin_dir}/*.schema ; do
-    cat $i | sqlite3 $db_file
-done
-
-${bin_dir}/fill_db_sql.pl "$PROJ" $info_file $db_file
-${bin_dir}/fill_db_caller_info.pl "$PROJ" $info_file $db_file
-${bin_dir}/build_early_index.sh $db_file
-
-${bin_dir}/fill_db_type_value.pl "$PROJ" $info_file $db_file
-${bin_dir}/fill_db_type_size.pl "$PROJ" $info_file $db_file
-${bin_dir}/build_late_index.sh $db_file
+if echo $info_file | grep -q '\.smatch_db$' ; then
+    # the per file databases from smatch --info-db
+    if ! "$SMATCH" --merge-db -p="$PROJ" $db_file "$@" ; then
+        exit 1
+    fi
+elif ! "$SMATCH" --build-db -p="$PROJ" $info_file $db_file ; then
+    exit 1
+fi
 
 ${bin_dir}/fixup_all.sh $db_file
 if [ "$PROJ" != "" ] ; then
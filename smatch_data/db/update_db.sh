@@ -0,0 +1,66 @@
+#!/bin/bash
+
+# Check the files which changed again and replace their rows in
+# smatch_db.sqlite.  The files which depend on what changed are checked
+# after that until the database stops changing.
+#
+# Set SMATCH_CHECK to the command used to check one file.  For the kernel
+# the default is "kchecker --info-db".
+
+if echo $1 | grep -q '^-p' ; then
+    PROJ=$(echo $1 | cut -d = -f 2)
+    shift
+fi
+
+if [[ "$1" = "" ]] ; then
+    echo "Usage:  $0 -p=<project> <file.c>..."
+    exit 1
+fi
+
+bin_dir=$(dirname $0)
+db_file=smatch_db.sqlite
+max_rounds=${MAX_ROUNDS:-5}
+
+if [ ! -e $db_file ] ; then
+    echo "$db_file not found.  Use create_db.sh first."
+    exit 1
+fi
+
+if [ "$SMATCH_CHECK" != "" ] ; then
+    CHECK="$SMATCH_CHECK"
+elif [ "$PROJ" = "kernel" ] ; then
+    CHECK="${bin_dir}/../../smatch_scripts/kchecker --info-db"
+else
+    CHECK="${bin_dir}/../../smatch -p=$PROJ --info-db"
+fi
+
+files="$*"
+round=0
+while [ "$files" != "" ] && [ $round -lt $max_rounds ] ; do
+    shards=""
+    for c_file in $files ; do
+        test -e $c_file || continue
+        echo "FILE $c_file"
+        $CHECK $c_file
+        test -e $c_file.smatch_db && shards="$shards $c_file.smatch_db"
+    done
+    if [ "$shards" = "" ] ; then
+        break
+    fi
+    files=$(${bin_dir}/../../smatch --update-db -p="$PROJ" $db_file $shards)
+    rm -f $shards
+    round=$((round + 1))
+done
+
+if [ "$files" != "" ] ; then
+    echo "Stopped after $max_rounds rounds.  These files still need to be checked:"
+    echo $files
+fi
+
+${bin_dir}/fixup_all.sh $db_file
+if [ "$PROJ" != "" ] ; then
+    ${bin_dir}/fixup_${PROJ}.sh $db_file
+fi
+
+${bin_dir}/remove_mixed_up_pointer_params.pl $db_file
+${bin_dir}/mark_function_ptrs_searchable.pl $db_file
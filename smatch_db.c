@@ -16,6 +16,7 @@
  */
 
 #include <string.h>
+#include <stdarg.h>
 #include <errno.h>
 #include <sqlite3.h>
 #include <unistd.h>
@@ -34,20 +35,11 @@ do {										\
 	if (!mem_db)								\
 		break;								\
 	if (__inline_fn) {							\
-		char buf[1024];							\
-		char *err, *p = buf;						\
-		int rc;								\
-										\
-		p += snprintf(p, buf + sizeof(buf) - p,				\
-			      "insert into %s values (", #table);		\
-		p += snprintf(p, buf + sizeof(buf) - p, values);		\
-		p += snprintf(p, buf + sizeof(buf) - p, ");");			\
-		sm_debug("in-mem: %s\n", buf);					\
-		rc = sqlite3_exec(mem_db, buf, NULL, 0, &err);			\
-		if (rc != SQLITE_OK) {						\
-			fprintf(stderr, "SQL error #2: %s\n", err);		\
-			fprintf(stderr, "SQL: '%s'\n", buf);			\
-		}								\
+		sql_mem_insert(#table, values);					\
+		break;								\
+	}									\
+	if (option_info_db) {							\
+		sql_info_insert(#table, values);				\
 		break;								\
 	}									\
 	if (option_info) {							\
@@ -133,7 +125,11 @@ void sql_exec(int (*callback)(void*, int, char**, char**), void *data, const cha
 	if (option_no_db || !db)
 		return;
 
+	if (option_profile)
+		__profile_push(__profile_owner(), PROF_SQL);
 	rc = sqlite3_exec(db, sql, callback, data, &err);
+	if (option_profile)
+		__profile_pop();
 	if (rc != SQLITE_OK) {
 		fprintf(stderr, "SQL error #2: %s\n", err);
 		fprintf(stderr, "SQL: '%s'\n", sql);
@@ -148,13 +144,263 @@ void sql_mem_exec(int (*callback)(void*, int, char**, char**), void *data, const
 	if (!mem_db)
 		return;
 
+	if (option_profile)
+		__profile_push(__profile_owner(), PROF_MEM_SQL);
 	rc = sqlite3_exec(mem_db, sql, callback, data, &err);
+	if (option_profile)
+		__profile_pop();
 	if (rc != SQLITE_OK) {
 		fprintf(stderr, "SQL error #2: %s\n", err);
 		fprintf(stderr, "SQL: '%s'\n", sql);
 	}
 }
 
+/*
+ * The inline code writes a lot of rows to the in-memory database.  Going
+ * through sqlite3_exec() means that every row gets printed as SQL and then
+ * parsed again so instead we keep a prepared insert for each table and bind
+ * the values to it.  The format string is the same as the one used to print
+ * the --info output and only the %s, %d and %lu conversions are understood.
+ * Anything else in the format string is passed through to the SQL.
+ *
+ * The inserts are batched in a transaction which is committed when the
+ * in-memory database is cleared at the end of the function.
+ */
+struct prepared_insert {
+	const char *table;
+	const char *fmt;
+	sqlite3_stmt *stmt;
+};
+#define MAX_INSERTS 32
+static struct prepared_insert mem_inserts[MAX_INSERTS];
+static int mem_transaction;
+static unsigned long mem_insert_rows;
+static unsigned long mem_insert_usec;
+
+/*
+ * Turn "'%s', %d, 0" into "?, ?, 0".
+ */
+static void fmt_to_sql(char *sql, int size, const char *table, const char *fmt)
+{
+	const char *p = fmt;
+	int pos;
+
+	pos = snprintf(sql, size, "insert into %s values (", table);
+	while (*p && pos < size - 3) {
+		if (strncmp(p, "'%s'", 4) == 0) {
+			sql[pos++] = '?';
+			p += 4;
+		} else if (p[0] == '%' && p[1] == '%') {
+			sql[pos++] = '%';
+			p += 2;
+		} else if (p[0] == '%') {
+			sql[pos++] = '?';
+			p++;
+			while (*p == 'l')
+				p++;
+			p++;
+		} else {
+			sql[pos++] = *p++;
+		}
+	}
+	sql[pos] = '\0';
+	snprintf(sql + pos, size - pos, ");");
+}
+
+static sqlite3_stmt *get_prepared_insert(sqlite3 *db, struct prepared_insert *inserts,
+					 const char *table, const char *fmt)
+{
+	char sql[256];
+	int rc;
+	int i;
+
+	for (i = 0; i < MAX_INSERTS; i++) {
+		if (!inserts[i].table)
+			break;
+		if (inserts[i].fmt == fmt &&
+		    strcmp(inserts[i].table, table) == 0)
+			return inserts[i].stmt;
+	}
+	if (i == MAX_INSERTS)
+		return NULL;
+
+	fmt_to_sql(sql, sizeof(sql), table, fmt);
+
+	rc = sqlite3_prepare_v2(db, sql, -1, &inserts[i].stmt, NULL);
+	if (rc != SQLITE_OK) {
+		fprintf(stderr, "SQL error #2: %s\n", sqlite3_errmsg(db));
+		fprintf(stderr, "SQL: '%s'\n", sql);
+		return NULL;
+	}
+	inserts[i].table = table;
+	inserts[i].fmt = fmt;
+	return inserts[i].stmt;
+}
+
+static void free_prepared_inserts(struct prepared_insert *inserts)
+{
+	int i;
+
+	for (i = 0; i < MAX_INSERTS; i++) {
+		if (!inserts[i].table)
+			break;
+		sqlite3_finalize(inserts[i].stmt);
+		inserts[i].table = NULL;
+	}
+}
+
+static void insert_row(sqlite3 *db, sqlite3_stmt *stmt, const char *fmt, va_list args)
+{
+	const char *p, *str;
+	int col = 1;
+	int rc;
+
+	for (p = fmt; *p; p++) {
+		if (*p != '%')
+			continue;
+		p++;
+		switch (*p) {
+		case 's':
+			/* snprintf() prints NULL as "(null)" so keep doing that */
+			str = va_arg(args, const char *);
+			sqlite3_bind_text(stmt, col++, str ? str : "(null)", -1, SQLITE_STATIC);
+			break;
+		case 'd':
+			sqlite3_bind_int(stmt, col++, va_arg(args, int));
+			break;
+		case 'l':
+			p++;
+			sqlite3_bind_int64(stmt, col++, va_arg(args, unsigned long));
+			break;
+		}
+	}
+
+	rc = sqlite3_step(stmt);
+	if (rc != SQLITE_DONE)
+		fprintf(stderr, "SQL error #2: %s\n", sqlite3_errmsg(db));
+	sqlite3_reset(stmt);
+}
+
+void sql_mem_insert(const char *table, const char *fmt, ...)
+{
+	struct timeval start, stop;
+	sqlite3_stmt *stmt;
+	va_list args;
+
+	if (!mem_db)
+		return;
+
+	gettimeofday(&start, NULL);
+
+	if (option_debug) {
+		char buf[1024];
+
+		va_start(args, fmt);
+		vsnprintf(buf, sizeof(buf), fmt, args);
+		va_end(args);
+		sm_debug("in-mem: insert into %s values (%s);\n", table, buf);
+	}
+
+	stmt = get_prepared_insert(mem_db, mem_inserts, table, fmt);
+	if (!stmt)
+		return;
+
+	if (!mem_transaction) {
+		sqlite3_exec(mem_db, "begin;", NULL, NULL, NULL);
+		mem_transaction = 1;
+	}
+
+	va_start(args, fmt);
+	insert_row(mem_db, stmt, fmt, args);
+	va_end(args);
+
+	gettimeofday(&stop, NULL);
+	mem_insert_rows++;
+	mem_insert_usec += (stop.tv_sec - start.tv_sec) * 1000000 +
+			   stop.tv_usec - start.tv_usec;
+}
+
+/*
+ * With --info-db the --info rows are written to a file.c.smatch_db SQLite
+ * file instead of being printed.  "smatch --merge-db" puts the files back
+ * together into smatch_db.sqlite.  The call IDs start at zero for each
+ * file and the merge renumbers them.  The shard_file table records which
+ * file the shard is for so --update-db can delete the old rows.
+ */
+static sqlite3 *info_db;
+static struct prepared_insert info_inserts[MAX_INSERTS];
+static int info_call_id;
+
+void open_info_db(const char *file)
+{
+	sqlite3_stmt *stmt;
+	char buf[256];
+
+	snprintf(buf, sizeof(buf), "%s.smatch_db", file);
+	unlink(buf);
+	if (sqlite3_open(buf, &info_db) != SQLITE_OK) {
+		printf("Error:  Cannot open %s\n", buf);
+		exit(1);
+	}
+	if (!load_db_schema(info_db)) {
+		printf("Error:  Cannot find the database schema files\n");
+		exit(1);
+	}
+	sqlite3_exec(info_db, "PRAGMA synchronous = OFF;", NULL, NULL, NULL);
+	sqlite3_exec(info_db, "PRAGMA journal_mode = OFF;", NULL, NULL, NULL);
+	sqlite3_exec(info_db, "begin;", NULL, NULL, NULL);
+	info_call_id = 0;
+
+	sqlite3_exec(info_db, "create table shard_file (file varchar(256));", NULL, NULL, NULL);
+	if (sqlite3_prepare_v2(info_db, "insert into shard_file values (?);", -1, &stmt, NULL) == SQLITE_OK) {
+		sqlite3_bind_text(stmt, 1, file, -1, SQLITE_STATIC);
+		sqlite3_step(stmt);
+		sqlite3_finalize(stmt);
+	}
+}
+
+void close_info_db(void)
+{
+	if (!info_db)
+		return;
+	free_prepared_inserts(info_inserts);
+	sqlite3_exec(info_db, "commit;", NULL, NULL, NULL);
+	sqlite3_close(info_db);
+	info_db = NULL;
+}
+
+void sql_info_insert(const char *table, const char *fmt, ...)
+{
+	sqlite3_stmt *stmt;
+	va_list args;
+
+	/* the same rows that sm_printf() would have printed */
+	if (!info_db || !final_pass)
+		return;
+
+	stmt = get_prepared_insert(info_db, info_inserts, table, fmt);
+	if (!stmt)
+		return;
+
+	va_start(args, fmt);
+	insert_row(info_db, stmt, fmt, args);
+	va_end(args);
+}
+
+static void commit_mem_inserts(void)
+{
+	if (!mem_transaction)
+		return;
+	sqlite3_exec(mem_db, "commit;", NULL, NULL, NULL);
+	mem_transaction = 0;
+}
+
+void sql_mem_stats(void)
+{
+	sm_msg("in-mem inserts: %lu rows %lu ms", mem_insert_rows,
+	       mem_insert_usec / 1000);
+}
+
 void sql_insert_return_states(int return_id, const char *return_ranges,
 		int type, int param, const char *key, const char *value)
 {
@@ -197,8 +443,8 @@ void sql_insert_caller_info(struct expression *call, int type,
 		return;
 
 	if (__inline_call) {
-		mem_sql(NULL, NULL,
-			"insert into caller_info values ('%s', '%s', '%s', %lu, %d, %d, %d, '%s', '%s');",
+		sql_mem_insert("caller_info",
+			"'%s', '%s', '%s', %lu, %d, %d, %d, '%s', '%s'",
 			get_base_file(), get_function(), fn, (unsigned long)call,
 			is_static(call->fn), type, param, key, value);
 	}
@@ -209,6 +455,17 @@ void sql_insert_caller_info(struct expression *call, int type,
 	if (is_common_function(fn))
 		return;
 
+	if (option_info_db) {
+		sql_info_insert("caller_info",
+			"'%s', '%s', '%s', %d, %d, %d, %d, '%s', '%s'",
+			get_base_file(), get_function(), fn, info_call_id,
+			is_static(call->fn), type, param, key, value);
+		if (final_pass && key && strcmp(key, "%call_marker%") == 0)
+			info_call_id++;
+		free_string(fn);
+		return;
+	}
+
 	sm_msg("SQL_caller_info: insert into caller_info values ("
 	       "'%s', '%s', '%s', %%CALL_ID%%, %d, %d, %d, '%s', '%s');",
 	       get_base_file(), get_function(), fn, is_static(call->fn),
@@ -292,6 +549,215 @@ static int get_row_count(void *unused, int argc, char **argv, char **azColName)
 	return 0;
 }
 
+/*
+ * The same functions get called over and over so we cache the return_states
+ * rows.  The cache is keyed by the "from ... where ..." part of the query and
+ * the rows are replayed to the callback in the same order that sqlite would
+ * have returned them.  Only the columns that smatch_function_hooks.c asks
+ * for are cached.
+ */
+#define RETURN_STATES_COLS "return_id, return, type, parameter, key, value"
+#define RS_CACHE_BUCKETS 1024
+#define RS_CACHE_MAX 2048
+
+struct rs_cache {
+	char *from;
+	int nr_cols;
+	int nr_rows;
+	int alloced;
+	int busy;
+	char **values;
+	struct rs_cache *hash_next;
+	struct rs_cache *prev, *next;
+};
+static struct rs_cache *rs_buckets[RS_CACHE_BUCKETS];
+static struct rs_cache rs_lru = { .prev = &rs_lru, .next = &rs_lru };
+static int rs_cache_used;
+static unsigned long rs_cache_hits, rs_cache_misses;
+
+static unsigned int rs_hash(const char *str)
+{
+	unsigned int hash = 5381;
+
+	while (*str)
+		hash = hash * 33 + (unsigned char)*str++;
+	return hash & (RS_CACHE_BUCKETS - 1);
+}
+
+static void rs_lru_del(struct rs_cache *entry)
+{
+	entry->prev->next = entry->next;
+	entry->next->prev = entry->prev;
+}
+
+static void rs_lru_add(struct rs_cache *entry)
+{
+	entry->next = rs_lru.next;
+	entry->prev = &rs_lru;
+	rs_lru.next->prev = entry;
+	rs_lru.next = entry;
+}
+
+static void free_rs_cache(struct rs_cache *entry)
+{
+	struct rs_cache **p;
+	int i;
+
+	for (p = &rs_buckets[rs_hash(entry->from)]; *p; p = &(*p)->hash_next) {
+		if (*p == entry) {
+			*p = entry->hash_next;
+			break;
+		}
+	}
+	rs_lru_del(entry);
+	for (i = 0; i < entry->nr_rows * entry->nr_cols; i++)
+		free(entry->values[i]);
+	free(entry->values);
+	free(entry->from);
+	free(entry);
+	rs_cache_used--;
+}
+
+static void rs_cache_evict(void)
+{
+	struct rs_cache *entry;
+
+	/* a callback can end up doing another lookup so skip the busy ones */
+	for (entry = rs_lru.prev; entry != &rs_lru; entry = entry->prev) {
+		if (!entry->busy) {
+			free_rs_cache(entry);
+			return;
+		}
+	}
+}
+
+static int rs_cache_callback(void *_entry, int argc, char **argv, char **azColName)
+{
+	struct rs_cache *entry = _entry;
+	int i;
+
+	if (entry->nr_rows == 0)
+		entry->nr_cols = argc;
+	if (argc != entry->nr_cols)
+		return 0;
+
+	if ((entry->nr_rows + 1) * argc > entry->alloced) {
+		entry->alloced = entry->alloced ? entry->alloced * 2 : 8 * argc;
+		entry->values = realloc(entry->values, entry->alloced * sizeof(char *));
+	}
+	for (i = 0; i < argc; i++)
+		entry->values[entry->nr_rows * argc + i] = argv[i] ? strdup(argv[i]) : NULL;
+	entry->nr_rows++;
+	return 0;
+}
+
+/*
+ * The "from" part can be as long as anything else in the query so these
+ * don't go through run_sql() and its fixed size buffer.
+ */
+static void rs_sql(int (*callback)(void*, int, char**, char**), void *data,
+		   const char *fmt, ...)
+{
+	va_list args;
+	char *sql;
+
+	va_start(args, fmt);
+	sql = sqlite3_vmprintf(fmt, args);
+	va_end(args);
+	if (!sql)
+		return;
+	sql_exec(callback, data, sql);
+	sqlite3_free(sql);
+}
+
+static struct rs_cache *fill_rs_cache(const char *from, int limit)
+{
+	struct rs_cache *entry;
+	unsigned int h;
+
+	while (rs_cache_used >= RS_CACHE_MAX)
+		rs_cache_evict();
+
+	entry = calloc(1, sizeof(*entry));
+	entry->from = strdup(from);
+
+	row_count = 0;
+	if (limit)
+		rs_sql(get_row_count, NULL, "select count(*) from %s;", from);
+	if (!limit || row_count <= limit)
+		rs_sql(rs_cache_callback, entry,
+			"select " RETURN_STATES_COLS " from %s order by return_id, type;",
+			from);
+
+	h = rs_hash(from);
+	entry->hash_next = rs_buckets[h];
+	rs_buckets[h] = entry;
+	rs_lru_add(entry);
+	rs_cache_used++;
+	return entry;
+}
+
+static struct rs_cache *get_rs_cache(const char *from, int limit)
+{
+	struct rs_cache *entry;
+
+	for (entry = rs_buckets[rs_hash(from)]; entry; entry = entry->hash_next) {
+		if (strcmp(entry->from, from) == 0) {
+			rs_cache_hits++;
+			rs_lru_del(entry);
+			rs_lru_add(entry);
+			return entry;
+		}
+	}
+	rs_cache_misses++;
+	return fill_rs_cache(from, limit);
+}
+
+static void select_cached_return_states(const char *cols,
+	int (*callback)(void*, int, char**, char**), void *info, int limit,
+	const char *fmt, ...)
+{
+	struct rs_cache *entry;
+	va_list args;
+	char *from;
+	int i;
+
+	if (option_no_db)
+		return;
+
+	va_start(args, fmt);
+	from = sqlite3_vmprintf(fmt, args);
+	va_end(args);
+	if (!from)
+		return;
+
+	if (option_debug || strcmp(cols, RETURN_STATES_COLS) != 0) {
+		row_count = 0;
+		if (limit)
+			rs_sql(get_row_count, info, "select count(*) from %s;", from);
+		if (!limit || row_count <= limit)
+			rs_sql(callback, info, "select %s from %s order by return_id, type;",
+			       cols, from);
+		sqlite3_free(from);
+		return;
+	}
+
+	entry = get_rs_cache(from, limit);
+	sqlite3_free(from);
+	entry->busy++;
+	for (i = 0; i < entry->nr_rows; i++) {
+		if (callback(info, entry->nr_cols, &entry->values[i * entry->nr_cols], NULL))
+			break;
+	}
+	entry->busy--;
+}
+
+void return_states_cache_stats(unsigned long *hits, unsigned long *misses)
+{
+	*hits = rs_cache_hits;
+	*misses = rs_cache_misses;
+}
+
 static void sql_select_return_states_pointer(const char *cols,
 	struct expression *call, int (*callback)(void*, int, char**, char**), void *info)
 {
@@ -301,11 +767,10 @@ static void sql_select_return_states_pointer(const char *cols,
 	if (!ptr)
 		return;
 
-	run_sql(callback, info,
-		"select %s from return_states join function_ptr where "
+	select_cached_return_states(cols, callback, info, 0,
+		"return_states join function_ptr where "
 		"return_states.function == function_ptr.function and ptr = '%s'"
-		"and searchable = 1 order by return_id, type;",
-		cols, ptr);
+		"and searchable = 1", ptr);
 }
 
 static int is_local_symbol(struct expression *expr)
@@ -335,14 +800,8 @@ void sql_select_return_states(const char *cols, struct expression *call,
 		return;
 	}
 
-	row_count = 0;
-	run_sql(get_row_count, info, "select count(*) from return_states where %s;",
-		get_static_filter(call->fn->symbol));
-	if (row_count > 3000)
-		return;
-
-	run_sql(callback, info, "select %s from return_states where %s order by return_id, type;",
-		cols, get_static_filter(call->fn->symbol));
+	select_cached_return_states(cols, callback, info, 3000,
+		"return_states where %s", get_static_filter(call->fn->symbol));
 }
 
 void sql_select_call_implies(const char *cols, struct expression *call,
@@ -945,7 +1404,7 @@ static int ptr_in_list(struct sm_state *sm, struct state_list *slist)
 	struct sm_state *tmp;
 
 	FOR_EACH_PTR(slist, tmp) {
-		if (strcmp(tmp->state->name, sm->state->name) == 0)
+		if (strcmp(show_state(tmp->state), show_state(sm->state)) == 0)
 			return 1;
 	} END_FOR_EACH_PTR(tmp);
 
@@ -1503,6 +1962,7 @@ static void reset_memdb(struct symbol *sym)
 	mem_sql(NULL, NULL, "delete from caller_info;");
 	mem_sql(NULL, NULL, "delete from return_states;");
 	mem_sql(NULL, NULL, "delete from call_implies;");
+	commit_mem_inserts();
 }
 
 static void match_end_func_info(struct symbol *sym)
@@ -1518,53 +1978,62 @@ static void match_after_func(struct symbol *sym)
 		reset_memdb(sym);
 }
 
-static void init_memdb(void)
+static const char *schema_files[] = {
+	"db/db.schema",
+	"db/caller_info.schema",
+	"db/return_states.schema",
+	"db/function_type_size.schema",
+	"db/type_size.schema",
+	"db/call_implies.schema",
+	"db/function_ptr.schema",
+	"db/local_values.schema",
+	"db/function_type_value.schema",
+	"db/type_value.schema",
+	"db/function_type_info.schema",
+	"db/data_info.schema",
+};
+
+int load_db_schema(sqlite3 *db)
 {
-	char *err = NULL;
-	int rc;
-	const char *schema_files[] = {
-		"db/db.schema",
-		"db/caller_info.schema",
-		"db/return_states.schema",
-		"db/function_type_size.schema",
-		"db/type_size.schema",
-		"db/call_implies.schema",
-		"db/function_ptr.schema",
-		"db/local_values.schema",
-		"db/function_type_value.schema",
-		"db/type_value.schema",
-		"db/function_type_info.schema",
-		"db/data_info.schema",
-	};
 	static char buf[4096];
+	char *err = NULL;
 	int fd;
 	int ret;
+	int rc;
 	int i;
 
-	rc = sqlite3_open(":memory:", &mem_db);
-	if (rc != SQLITE_OK) {
-		printf("Error starting In-Memory database.");
-		return;
-	}
-
 	for (i = 0; i < ARRAY_SIZE(schema_files); i++) {
 		fd = open_data_file(schema_files[i]);
-		if (fd < 0) {
-			mem_db = NULL;
-			return;
-		}
+		if (fd < 0)
+			return 0;
 		ret = read(fd, buf, sizeof(buf));
+		close(fd);
 		if (ret == sizeof(buf)) {
 			printf("Schema file too large:  %s (limit %zd bytes)",
 			       schema_files[i], sizeof(buf));
 		}
 		buf[ret] = '\0';
-		rc = sqlite3_exec(mem_db, buf, NULL, 0, &err);
+		rc = sqlite3_exec(db, buf, NULL, 0, &err);
 		if (rc != SQLITE_OK) {
 			fprintf(stderr, "SQL error #2: %s\n", err);
 			fprintf(stderr, "%s\n", buf);
 		}
 	}
+	return 1;
+}
+
+static void init_memdb(void)
+{
+	int rc;
+
+	rc = sqlite3_open(":memory:", &mem_db);
+	if (rc != SQLITE_OK) {
+		printf("Error starting In-Memory database.");
+		return;
+	}
+
+	if (!load_db_schema(mem_db))
+		mem_db = NULL;
 }
 
 void open_smatch_db(void)
@@ -182,7 +182,10 @@ int estates_equiv(struct smatch_state *one, struct smatch_state *two)
 		return 1;
 	if (!rlists_equiv(estate_related(one), estate_related(two)))
 		return 0;
-	if (strcmp(one->name, two->name) == 0)
+	/* don't print the names if we don't have to */
+	if (one->name == two->name && estate_rl(one) == estate_rl(two))
+		return 1;
+	if (strcmp(show_state(one), show_state(two)) == 0)
 		return 1;
 	return 0;
 }
@@ -294,13 +297,28 @@ struct smatch_state *extra_empty(void)
 	return ret;
 }
 
+/* most estates are never printed so the name is filled in by show_state() */
+static const char *show_estate(struct smatch_state *state)
+{
+	return show_rl(estate_rl(state));
+}
+
+static const char *estate_name(void)
+{
+	static const char *name;
+
+	if (!name)
+		name = lazy_state_name(&show_estate);
+	return name;
+}
+
 struct smatch_state *alloc_estate_sval(sval_t sval)
 {
 	struct smatch_state *state;
 
 	state = __alloc_smatch_state(0);
 	state->data = alloc_dinfo_range(sval, sval);
-	state->name = show_rl(get_dinfo(state)->value_ranges);
+	state->name = estate_name();
 	estate_set_hard_max(state);
 	estate_set_fuzzy_max(state, sval);
 	return state;
@@ -312,7 +330,7 @@ struct smatch_state *alloc_estate_range(sval_t min, sval_t max)
 
 	state = __alloc_smatch_state(0);
 	state->data = alloc_dinfo_range(min, max);
-	state->name = show_rl(get_dinfo(state)->value_ranges);
+	state->name = estate_name();
 	return state;
 }
 
@@ -325,7 +343,7 @@ struct smatch_state *alloc_estate_rl(struct range_list *rl)
 
 	state = __alloc_smatch_state(0);
 	state->data = alloc_dinfo_range_list(rl);
-	state->name = show_rl(rl);
+	state->name = estate_name();
 	return state;
 }
 
@@ -341,7 +359,7 @@ struct smatch_state *clone_estate_cast(struct symbol *type, struct smatch_state
 	dinfo->value_ranges = clone_rl(cast_rl(type, estate_rl(state)));
 
 	ret = __alloc_smatch_state(0);
-	ret->name = show_rl(dinfo->value_ranges);
+	ret->name = estate_name();
 	ret->data = dinfo;
 
 	return ret;
@@ -405,7 +423,7 @@ struct smatch_state *clone_estate_perm(struct smatch_state *state)
 	struct smatch_state *ret;
 
 	ret = malloc(sizeof(*ret));
-	ret->name = alloc_string(state->name);
+	ret->name = alloc_string(show_state(state));
 	ret->data = clone_dinfo_perm(get_dinfo(state));
 	return ret;
 }
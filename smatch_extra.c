@@ -232,7 +232,7 @@ void set_extra_nomod(const char *name, struct symbol *sym, struct smatch_state *
 		struct smatch_state *estate;
 
 		if (option_debug_related)
-			sm_msg("%s updating related %s to %s", name, rel->name, state->name);
+			sm_msg("%s updating related %s to %s", name, rel->name, show_state(state));
 		estate = get_state(SMATCH_EXTRA, rel->name, rel->sym);
 		if (!estate)
 			continue;
@@ -1839,7 +1839,7 @@ static void struct_member_callback(struct expression *call, int param, char *pri
 		return;
 	if (filter_unused_kzalloc_info(call, param, printed_name, sm))
 		return;
-	sql_insert_caller_info(call, PARAM_VALUE, param, printed_name, sm->state->name);
+	sql_insert_caller_info(call, PARAM_VALUE, param, printed_name, show_state(sm->state));
 	if (estate_has_fuzzy_max(sm->state))
 		sql_insert_caller_info(call, FUZZY_MAX, param, printed_name,
 				       sval_to_str(estate_get_fuzzy_max(sm->state)));
@@ -1871,7 +1871,7 @@ static void returned_struct_members(int return_id, char *return_ranges, struct e
 		compare_str = name_sym_to_param_comparison(sm->name, sm->sym);
 		if (!compare_str && estate_is_whole(sm->state))
 			continue;
-		snprintf(buf, sizeof(buf), "%s%s", sm->state->name, compare_str ?: "");
+		snprintf(buf, sizeof(buf), "%s%s", show_state(sm->state), compare_str ?: "");
 
 		sql_insert_return_states(return_id, return_ranges, PARAM_VALUE,
 					 -1, param_name, buf);
@@ -16,8 +16,11 @@
  */
 
 #define _GNU_SOURCE 1
+#include <errno.h>
 #include <unistd.h>
 #include <stdio.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
 #include "token.h"
 #include "scope.h"
 #include "smatch.h"
@@ -1486,6 +1489,9 @@ static void split_function(struct symbol *sym)
 		return;
 
 	gettimeofday(&fn_start_time, NULL);
+	if (option_profile)
+		__profile_start_function();
+	__start_mem_budget();
 	cur_func_sym = sym;
 	if (sym->ident)
 		cur_func = sym->ident->name;
@@ -1513,11 +1519,13 @@ static void split_function(struct symbol *sym)
 	if (need_delayed_scope_hooks())
 		__call_scope_hooks();
 	__pass_to_client(sym, AFTER_FUNC_HOOK);
+	if (option_profile)
+		__profile_end_function(cur_func);
 
 	clear_all_states();
 	cur_func_sym = NULL;
 	cur_func = NULL;
-	free_data_info_allocs();
+	arena_release(&function_arena);
 	free_expression_stack(&switch_expr_stack);
 	__free_ptr_list((struct ptr_list **)&big_statement_stack);
 	__bail_on_rest_of_function = 0;
@@ -1678,6 +1686,226 @@ static struct stree *clone_estates_perm(struct stree *orig)
 }
 
 struct position last_pos;
+
+/*
+ * With --jobs=N the functions in a file are handed out to N forked workers.
+ * The parse tree is shared copy-on-write so each worker has its own copy of
+ * the path state.  Functions are taken from a shared counter so a worker that
+ * finishes early just picks up the next one.  The output for each function is
+ * sent back along with the list of inline functions it called and the parent
+ * prints them in source order and analyzes the inlines itself so the output
+ * is the same as the serial run.  The debug code uses printf() so stdout is
+ * captured as well.  It goes in the same buffer when sm_outfd is stdout so
+ * the two stay in order.
+ */
+struct job_record {
+	int idx;
+	int len;
+	int stdout_len;
+	int nr_inlines;
+};
+
+struct job_result {
+	char *buf;
+	int len;
+	char *stdout_buf;
+	int stdout_len;
+	struct symbol_list *inlines;
+	int done;
+};
+
+static int count_functions(struct symbol_list *sym_list)
+{
+	struct symbol *sym;
+	int nr = 0;
+
+	FOR_EACH_PTR(sym_list, sym) {
+		if (sym->type == SYM_NODE && get_base_type(sym)->type == SYM_FN)
+			nr++;
+	} END_FOR_EACH_PTR(sym);
+
+	return nr;
+}
+
+static int can_use_jobs(int nr_funcs)
+{
+	if (option_jobs < 2 || nr_funcs < 2)
+		return 0;
+	/* The --info output has per-file tables built up across functions */
+	if (option_info)
+		return 0;
+	if (option_profile)
+		return 0;
+	return 1;
+}
+
+static void run_job_worker(struct symbol **funcs, int nr_funcs, int *next, FILE *out)
+{
+	int shared = (sm_outfd == stdout);
+	struct job_record rec;
+	struct symbol *sym;
+	char *buf, *stdout_buf;
+	size_t size, stdout_size;
+	int i;
+
+	while ((i = __sync_fetch_and_add(next, 1)) < nr_funcs) {
+		buf = stdout_buf = NULL;
+		size = stdout_size = 0;
+		sm_outfd = open_memstream(&buf, &size);
+		if (!sm_outfd)
+			_exit(1);
+		if (shared)
+			stdout = sm_outfd;
+		else
+			stdout = open_memstream(&stdout_buf, &stdout_size);
+		if (!stdout)
+			_exit(1);
+		set_position(funcs[i]->pos);
+		split_function(funcs[i]);
+		if (!shared)
+			fclose(stdout);
+		fclose(sm_outfd);
+
+		rec.idx = i;
+		rec.len = size;
+		rec.stdout_len = stdout_size;
+		rec.nr_inlines = ptr_list_size((struct ptr_list *)inlines_called);
+		fwrite(&rec, sizeof(rec), 1, out);
+		fwrite(buf, 1, size, out);
+		fwrite(stdout_buf, 1, stdout_size, out);
+		FOR_EACH_PTR(inlines_called, sym) {
+			fwrite(&sym, sizeof(sym), 1, out);
+		} END_FOR_EACH_PTR(sym);
+		free_ptr_list(&inlines_called);
+		free(buf);
+		free(stdout_buf);
+	}
+	if (fflush(out))
+		_exit(1);
+	_exit(0);
+}
+
+static void read_job_results(FILE *in, struct job_result *results, int nr_funcs)
+{
+	struct job_record rec;
+	struct symbol *sym;
+	int i;
+
+	rewind(in);
+	while (fread(&rec, sizeof(rec), 1, in) == 1) {
+		if (rec.idx < 0 || rec.idx >= nr_funcs)
+			return;
+		results[rec.idx].buf = malloc(rec.len + 1);
+		if (fread(results[rec.idx].buf, 1, rec.len, in) != rec.len)
+			return;
+		results[rec.idx].len = rec.len;
+		results[rec.idx].stdout_buf = malloc(rec.stdout_len + 1);
+		if (fread(results[rec.idx].stdout_buf, 1, rec.stdout_len, in) != rec.stdout_len)
+			return;
+		results[rec.idx].stdout_len = rec.stdout_len;
+		for (i = 0; i < rec.nr_inlines; i++) {
+			if (fread(&sym, sizeof(sym), 1, in) != 1)
+				return;
+			add_ptr_list(&results[rec.idx].inlines, sym);
+		}
+		results[rec.idx].done = 1;
+	}
+}
+
+static struct job_result *run_jobs(struct symbol **funcs, int nr_funcs)
+{
+	struct job_result *results;
+	FILE **files;
+	int *next;
+	pid_t pid;
+	int i;
+
+	next = mmap(NULL, sizeof(*next), PROT_READ | PROT_WRITE,
+		    MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (next == MAP_FAILED)
+		return NULL;
+	*next = 0;
+
+	results = calloc(nr_funcs, sizeof(*results));
+	files = calloc(option_jobs, sizeof(*files));
+
+	fflush(NULL);
+	for (i = 0; i < option_jobs; i++) {
+		files[i] = tmpfile();
+		if (!files[i])
+			break;
+		pid = fork();
+		if (pid == 0)
+			run_job_worker(funcs, nr_funcs, next, files[i]);
+		if (pid < 0) {
+			fclose(files[i]);
+			files[i] = NULL;
+			break;
+		}
+	}
+	while (wait(NULL) > 0)
+		;
+
+	/*
+	 * If a worker died then the functions it didn't finish are missing
+	 * from the results and get analyzed by the parent instead.
+	 */
+	for (i = 0; i < option_jobs; i++) {
+		if (!files[i])
+			continue;
+		read_job_results(files[i], results, nr_funcs);
+		fclose(files[i]);
+	}
+	free(files);
+	munmap(next, sizeof(*next));
+
+	return results;
+}
+
+static void split_functions_jobs(struct symbol_list *sym_list)
+{
+	struct job_result *results;
+	struct symbol **funcs;
+	struct symbol *sym, *inline_sym;
+	int nr_funcs;
+	int i;
+
+	nr_funcs = count_functions(sym_list);
+	funcs = malloc(nr_funcs * sizeof(*funcs));
+	i = 0;
+	FOR_EACH_PTR(sym_list, sym) {
+		if (sym->type == SYM_NODE && get_base_type(sym)->type == SYM_FN)
+			funcs[i++] = sym;
+	} END_FOR_EACH_PTR(sym);
+
+	results = run_jobs(funcs, nr_funcs);
+
+	i = 0;
+	FOR_EACH_PTR(sym_list, sym) {
+		set_position(sym->pos);
+		if (sym->type == SYM_NODE && get_base_type(sym)->type == SYM_FN) {
+			if (results && results[i].done) {
+				fwrite(results[i].buf, 1, results[i].len, sm_outfd);
+				fwrite(results[i].stdout_buf, 1, results[i].stdout_len, stdout);
+				FOR_EACH_PTR(results[i].inlines, inline_sym) {
+					add_inline_function(inline_sym);
+				} END_FOR_EACH_PTR(inline_sym);
+				free(results[i].buf);
+				free(results[i].stdout_buf);
+				free_ptr_list(&results[i].inlines);
+			} else {
+				split_function(sym);
+			}
+			process_inlines();
+			i++;
+		}
+		last_pos = sym->pos;
+	} END_FOR_EACH_PTR(sym);
+
+	free(results);
+	free(funcs);
+}
+
 static void split_functions(struct symbol_list *sym_list)
 {
 	struct symbol *sym;
@@ -1693,23 +1921,89 @@ static void split_functions(struct symbol_list *sym_list)
 	global_states = clone_estates_perm(get_all_states_stree(SMATCH_EXTRA));
 	nullify_path();
 
-	FOR_EACH_PTR(sym_list, sym) {
-		set_position(sym->pos);
-		if (sym->type == SYM_NODE && get_base_type(sym)->type == SYM_FN) {
-			split_function(sym);
-			process_inlines();
-		}
-		last_pos = sym->pos;
-	} END_FOR_EACH_PTR(sym);
+	if (can_use_jobs(count_functions(sym_list))) {
+		split_functions_jobs(sym_list);
+	} else {
+		FOR_EACH_PTR(sym_list, sym) {
+			set_position(sym->pos);
+			if (sym->type == SYM_NODE && get_base_type(sym)->type == SYM_FN) {
+				split_function(sym);
+				process_inlines();
+			}
+			last_pos = sym->pos;
+		} END_FOR_EACH_PTR(sym);
+	}
 	split_inlines(sym_list);
 	__pass_to_client(sym_list, END_FILE_HOOK);
 }
 
-void smatch(int argc, char **argv)
+static void check_file(char *file)
 {
-	struct string_list *filelist = NULL;
 	struct symbol_list *sym_list;
+
+	if (option_file_output) {
+		char buf[256];
+
+		snprintf(buf, sizeof(buf), "%s.smatch", file);
+		sm_outfd = fopen(buf, "w");
+		if (!sm_outfd) {
+			printf("Error:  Cannot open %s\n", file);
+			exit(1);
+		}
+	}
+	if (option_info_db)
+		open_info_db(file);
+	sym_list = sparse_keep_tokens(file);
+	split_functions(sym_list);
+	close_info_db();
+	if (option_profile)
+		__profile_report(file);
+}
+
+/*
+ * With __fork_per_file every file is checked in a child forked from the
+ * state we have right after sparse_initialize() so nothing one file does
+ * is seen by the next one and the memory goes away with the child.
+ */
+int __fork_per_file;
+
+static int check_file_forked(char *file)
+{
+	int status;
+	pid_t pid;
+
+	fflush(stdout);
+	fflush(sm_outfd);
+	pid = fork();
+	if (pid < 0) {
+		check_file(file);
+		return 0;
+	}
+	if (pid == 0) {
+		check_file(file);
+		fflush(sm_outfd);
+		exit(0);
+	}
+	while (waitpid(pid, &status, 0) < 0) {
+		if (errno != EINTR)
+			return 1;
+	}
+	if (!WIFEXITED(status) || WEXITSTATUS(status)) {
+		fprintf(stderr, "%s: smatch failed\n", file);
+		return 1;
+	}
+	return 0;
+}
+
+/*
+ * Returns non-zero if checking any of the files failed.  That can only be
+ * noticed when the files are forked.
+ */
+int smatch(int argc, char **argv)
+{
+	struct string_list *filelist = NULL;
 	struct timeval stop, start;
+	int failed = 0;
 
 	gettimeofday(&start, NULL);
 
@@ -1720,23 +2014,21 @@ void smatch(int argc, char **argv)
 	sparse_initialize(argc, argv, &filelist);
 	set_valid_ptr_max();
 	FOR_EACH_PTR_NOTAG(filelist, base_file) {
-		if (option_file_output) {
-			char buf[256];
-
-			snprintf(buf, sizeof(buf), "%s.smatch", base_file);
-			sm_outfd = fopen(buf, "w");
-			if (!sm_outfd) {
-				printf("Error:  Cannot open %s\n", base_file);
-				exit(1);
-			}
-		}
-		sym_list = sparse_keep_tokens(base_file);
-		split_functions(sym_list);
+		if (__fork_per_file)
+			failed |= check_file_forked(base_file);
+		else
+			check_file(base_file);
 	} END_FOR_EACH_PTR_NOTAG(base_file);
 
 	gettimeofday(&stop, NULL);
 
 	set_position(last_pos);
-	if (option_time)
+	if (option_time) {
 		sm_msg("time: %lu", stop.tv_sec - start.tv_sec);
+		sql_mem_stats();
+		modification_hook_stats();
+		show_token_cache_stats();
+		show_token_store_stats();
+	}
+	return failed;
 }
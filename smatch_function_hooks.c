@@ -42,6 +42,7 @@ struct fcall_back {
 		implied_return_hook *implied_return;
 	} u;
 	void *info;
+	int owner;
 };
 
 ALLOCATOR(fcall_back, "call backs");
@@ -60,13 +61,27 @@ static struct hashtable *func_hash;
 struct return_implies_callback {
 	int type;
 	return_implies_hook *callback;
+	int owner;
 };
+
+/* --profile counts the time for the check which added the hook */
+#define PROFILE_CALL(owner, call) do {				\
+	if (option_profile)					\
+		__profile_push(owner, PROF_FUNCTION_HOOK);	\
+	call;							\
+	if (option_profile)					\
+		__profile_pop();				\
+} while (0)
 ALLOCATOR(return_implies_callback, "return_implies callbacks");
 DECLARE_PTR_LIST(db_implies_list, struct return_implies_callback);
 static struct db_implies_list *db_return_states_list;
 
 typedef void (void_fn)(void);
-DECLARE_PTR_LIST(void_fn_list, void_fn *);
+struct void_fn_hook {
+	void_fn *fn;
+	int owner;
+};
+DECLARE_PTR_LIST(void_fn_list, struct void_fn_hook);
 static struct void_fn_list *return_states_before;
 static struct void_fn_list *return_states_after;
 
@@ -79,6 +94,7 @@ static struct fcall_back *alloc_fcall_back(int type, void *call_back,
 	cb->type = type;
 	cb->u.call_back = call_back;
 	cb->info = info;
+	cb->owner = __get_hook_owner();
 	return cb;
 }
 
@@ -143,39 +159,45 @@ void select_return_states_hook(int type, return_implies_hook *callback)
 
 	cb->type = type;
 	cb->callback = callback;
+	cb->owner = __get_hook_owner();
 	add_ptr_list(&db_return_states_list, cb);
 }
 
+static void add_void_fn_hook(struct void_fn_list **list, void_fn *fn)
+{
+	struct void_fn_hook *p = malloc(sizeof(*p));
+
+	p->fn = fn;
+	p->owner = __get_hook_owner();
+	add_ptr_list(list, p);
+}
+
 void select_return_states_before(void_fn *fn)
 {
-	void_fn **p = malloc(sizeof(void_fn *));
-	*p = fn;
-	add_ptr_list(&return_states_before, p);
+	add_void_fn_hook(&return_states_before, fn);
 }
 
 void select_return_states_after(void_fn *fn)
 {
-	void_fn **p = malloc(sizeof(void_fn *));
-	*p = fn;
-	add_ptr_list(&return_states_after, p);
+	add_void_fn_hook(&return_states_after, fn);
 }
 
 static void call_return_states_before_hooks(void)
 {
-	void_fn **fn;
+	struct void_fn_hook *hook;
 
-	FOR_EACH_PTR(return_states_before, fn) {
-		(*fn)();
-	} END_FOR_EACH_PTR(fn);
+	FOR_EACH_PTR(return_states_before, hook) {
+		PROFILE_CALL(hook->owner, hook->fn());
+	} END_FOR_EACH_PTR(hook);
 }
 
 static void call_return_states_after_hooks(struct expression *expr)
 {
-	void_fn **fn;
+	struct void_fn_hook *hook;
 
-	FOR_EACH_PTR(return_states_after, fn) {
-		(*fn)();
-	} END_FOR_EACH_PTR(fn);
+	FOR_EACH_PTR(return_states_after, hook) {
+		PROFILE_CALL(hook->owner, hook->fn());
+	} END_FOR_EACH_PTR(hook);
 	__pass_to_client(expr, FUNCTION_CALL_HOOK_AFTER_DB);
 }
 
@@ -187,7 +209,7 @@ static int call_call_backs(struct call_back_list *list, int type,
 
 	FOR_EACH_PTR(list, tmp) {
 		if (tmp->type == type) {
-			(tmp->u.call_back)(fn, expr, tmp->info);
+			PROFILE_CALL(tmp->owner, (tmp->u.call_back)(fn, expr, tmp->info));
 			handled = 1;
 		}
 	} END_FOR_EACH_PTR(tmp);
@@ -202,7 +224,7 @@ static void call_ranged_call_backs(struct call_back_list *list,
 	struct fcall_back *tmp;
 
 	FOR_EACH_PTR(list, tmp) {
-		(tmp->u.ranged)(fn, call_expr, assign_expr, tmp->info);
+		PROFILE_CALL(tmp->owner, (tmp->u.ranged)(fn, call_expr, assign_expr, tmp->info));
 	} END_FOR_EACH_PTR(tmp);
 }
 
@@ -312,7 +334,7 @@ static void call_implies_callbacks(int comparison, struct expression *expr, sval
 			continue;
 		if (!true_comparison_range_LR(comparison, tmp->range, value_range, left))
 			continue;
-		(tmp->u.ranged)(fn, expr, NULL, tmp->info);
+		PROFILE_CALL(tmp->owner, (tmp->u.ranged)(fn, expr, NULL, tmp->info));
 	} END_FOR_EACH_PTR(tmp);
 	tmp_stree = __pop_fake_cur_stree();
 	merge_fake_stree(&true_states, tmp_stree);
@@ -325,7 +347,7 @@ static void call_implies_callbacks(int comparison, struct expression *expr, sval
 			continue;
 		if (!false_comparison_range_LR(comparison, tmp->range, value_range, left))
 			continue;
-		(tmp->u.ranged)(fn, expr, NULL, tmp->info);
+		PROFILE_CALL(tmp->owner, (tmp->u.ranged)(fn, expr, NULL, tmp->info));
 	} END_FOR_EACH_PTR(tmp);
 	tmp_stree = __pop_fake_cur_stree();
 	merge_fake_stree(&false_states, tmp_stree);
@@ -510,7 +532,7 @@ static int db_compare_callback(void *_info, int argc, char **argv, char **azColN
 
 	FOR_EACH_PTR(db_info->callbacks, tmp) {
 		if (tmp->type == type)
-			tmp->callback(db_info->expr, param, key, value);
+			PROFILE_CALL(tmp->owner, tmp->callback(db_info->expr, param, key, value));
 	} END_FOR_EACH_PTR(tmp);
 
 	store_return_state(db_info, alloc_estate_rl(clone_rl(var_rl)));
@@ -686,7 +708,7 @@ static void call_ranged_return_hooks(struct db_callback_info *db_info)
 		range_rl = cast_rl(estate_type(db_info->ret_state), range_rl);
 		if (possibly_true_rl(range_rl, SPECIAL_EQUAL, estate_rl(db_info->ret_state))) {
 			if (!possibly_true_rl(rl_invert(range_rl), SPECIAL_EQUAL, estate_rl(db_info->ret_state)))
-				(tmp->u.ranged)(fn, expr, db_info->expr, tmp->info);
+				PROFILE_CALL(tmp->owner, (tmp->u.ranged)(fn, expr, db_info->expr, tmp->info));
 			else
 				db_info->handled = -1;
 		}
@@ -750,7 +772,7 @@ static int db_assign_return_states_callback(void *_info, int argc, char **argv,
 
 	FOR_EACH_PTR(db_return_states_list, tmp) {
 		if (tmp->type == type)
-			tmp->callback(db_info->expr, param, key, value);
+			PROFILE_CALL(tmp->owner, tmp->callback(db_info->expr, param, key, value));
 	} END_FOR_EACH_PTR(tmp);
 	store_return_state(db_info, alloc_estate_rl(ret_range));
 
@@ -780,7 +802,7 @@ static int db_return_states_assign(struct expression *expr)
 		sm_msg("%s return_id %d return_ranges %s",
 			db_info.cull ? "culled" : "merging",
 			db_info.prev_return_id,
-			db_info.ret_state ? db_info.ret_state->name : "'<empty>'");
+			db_info.ret_state ? show_state(db_info.ret_state) : "'<empty>'");
 	}
 	if (db_info.handled)
 		call_ranged_return_hooks(&db_info);
@@ -914,7 +936,7 @@ static int db_return_states_callback(void *_info, int argc, char **argv, char **
 
 	FOR_EACH_PTR(db_return_states_list, tmp) {
 		if (tmp->type == type)
-			tmp->callback(db_info->expr, param, key, value);
+			PROFILE_CALL(tmp->owner, tmp->callback(db_info->expr, param, key, value));
 	} END_FOR_EACH_PTR(tmp);
 
 	/*
@@ -1032,7 +1054,7 @@ int get_implied_return(struct expression *expr, struct range_list **rl)
 
 	FOR_EACH_PTR(call_backs, tmp) {
 		if (tmp->type == IMPLIED_RETURN) {
-			(tmp->u.implied_return)(expr, tmp->info, rl);
+			PROFILE_CALL(tmp->owner, (tmp->u.implied_return)(expr, tmp->info, rl));
 			handled = 1;
 		}
 	} END_FOR_EACH_PTR(tmp);
@@ -532,10 +532,38 @@ struct expression *get_array_offset(struct expression *expr)
 	return strip_parens(expr->right);
 }
 
+/*
+ * Some states have names which are expensive to print and are hardly ever
+ * looked at.  Those states use a place holder name from lazy_state_name()
+ * and show_state() calls the formatter the first time someone asks.
+ */
+#define MAX_LAZY_NAMES 8
+static char lazy_names[MAX_LAZY_NAMES];
+static state_name_fn *lazy_name_fns[MAX_LAZY_NAMES];
+static int num_lazy_names;
+
+const char *lazy_state_name(state_name_fn *fn)
+{
+	int i;
+
+	for (i = 0; i < num_lazy_names; i++) {
+		if (lazy_name_fns[i] == fn)
+			return &lazy_names[i];
+	}
+	if (num_lazy_names == MAX_LAZY_NAMES) {
+		printf("error:  too many lazy state names.  Increase MAX_LAZY_NAMES.\n");
+		exit(1);
+	}
+	lazy_name_fns[num_lazy_names] = fn;
+	return &lazy_names[num_lazy_names++];
+}
+
 const char *show_state(struct smatch_state *state)
 {
 	if (!state)
 		return NULL;
+	if (state->name >= lazy_names && state->name < lazy_names + num_lazy_names)
+		state->name = lazy_name_fns[state->name - lazy_names](state);
 	return state->name;
 }
 
@@ -27,6 +27,7 @@ enum data_type {
 struct hook_container {
 	int hook_type;
 	enum data_type data_type;
+	int owner;
 	void *fn;
 };
 ALLOCATOR(hook_container, "hook functions");
@@ -39,17 +40,32 @@ void (**pre_merge_hooks)(struct sm_state *sm);
 struct scope_container {
 	void *fn;
 	void *data;
+	int owner;
 };
 ALLOCATOR(scope_container, "scope hook functions");
 DECLARE_PTR_LIST(scope_hook_list, struct scope_container);
 DECLARE_PTR_LIST(scope_hook_stack, struct scope_hook_list);
 static struct scope_hook_stack *scope_hooks;
 
+/* the check which is registering its hooks.  It's used for --profile. */
+static int hook_owner;
+
+void __set_hook_owner(int owner)
+{
+	hook_owner = owner;
+}
+
+int __get_hook_owner(void)
+{
+	return hook_owner;
+}
+
 void add_hook(void *func, enum hook_type type)
 {
 	struct hook_container *container = __alloc_hook_container(0);
 
 	container->hook_type = type;
+	container->owner = hook_owner;
 	container->fn = func;
 	switch (type) {
 	case EXPR_HOOK:
@@ -218,6 +234,8 @@ void __pass_to_client(void *data, enum hook_type type)
 
 
 	FOR_EACH_PTR(hook_array[type], container) {
+		if (option_profile)
+			__profile_push(container->owner, type);
 		switch (container->data_type) {
 		case EXPR_PTR:
 			pass_expr_to_client(container->fn, data);
@@ -232,6 +250,8 @@ void __pass_to_client(void *data, enum hook_type type)
 			pass_sym_list_to_client(container->fn, data);
 			break;
 		}
+		if (option_profile)
+			__profile_pop();
 	} END_FOR_EACH_PTR(container);
 }
 
@@ -240,7 +260,11 @@ void __pass_to_client_no_data(enum hook_type type)
 	struct hook_container *container;
 
 	FOR_EACH_PTR(hook_array[type], container) {
+		if (option_profile)
+			__profile_push(container->owner, type);
 		pass_to_client(container->fn);
+		if (option_profile)
+			__profile_pop();
 	} END_FOR_EACH_PTR(container);
 }
 
@@ -252,7 +276,11 @@ void __pass_case_to_client(struct expression *switch_expr,
 	struct hook_container *container;
 
 	FOR_EACH_PTR(hook_array[CASE_HOOK], container) {
+		if (option_profile)
+			__profile_push(container->owner, CASE_HOOK);
 		((case_func *) container->fn)(switch_expr, rl);
+		if (option_profile)
+			__profile_pop();
 	} END_FOR_EACH_PTR(container);
 }
 
@@ -275,15 +303,21 @@ struct smatch_state *__client_merge_function(int owner,
 	struct hook_container *tmp;
 
 	/* Pass NULL states first and the rest alphabetically by name */
-	if (!s2 || (s1 && strcmp(s2->name, s1->name) < 0)) {
+	if (!s2 || (s1 && strcmp(show_state(s2), show_state(s1)) < 0)) {
 		tmp_state = s1;
 		s1 = s2;
 		s2 = tmp_state;
 	}
 
 	FOR_EACH_PTR(merge_funcs, tmp) {
-		if (tmp->data_type == owner)
+		if (tmp->data_type != owner)
+			continue;
+		if (!option_profile)
 			return ((merge_func_t *) tmp->fn)(s1, s2);
+		__profile_push(owner, PROF_MERGE);
+		tmp_state = ((merge_func_t *) tmp->fn)(s1, s2);
+		__profile_pop();
+		return tmp_state;
 	} END_FOR_EACH_PTR(tmp);
 	return &undefined;
 }
@@ -291,10 +325,17 @@ struct smatch_state *__client_merge_function(int owner,
 struct smatch_state *__client_unmatched_state_function(struct sm_state *sm)
 {
 	struct hook_container *tmp;
+	struct smatch_state *state;
 
 	FOR_EACH_PTR(unmatched_state_funcs, tmp) {
-		if (tmp->data_type == sm->owner)
+		if (tmp->data_type != sm->owner)
+			continue;
+		if (!option_profile)
 			return ((unmatched_func_t *) tmp->fn)(sm);
+		__profile_push(sm->owner, PROF_UNMATCHED);
+		state = ((unmatched_func_t *) tmp->fn)(sm);
+		__profile_pop();
+		return state;
 	} END_FOR_EACH_PTR(tmp);
 	return &undefined;
 }
@@ -304,8 +345,13 @@ void call_pre_merge_hook(struct sm_state *sm)
 	if (sm->owner >= num_checks)
 		return;
 
-	if (pre_merge_hooks[sm->owner])
-		pre_merge_hooks[sm->owner](sm);
+	if (!pre_merge_hooks[sm->owner])
+		return;
+	if (option_profile)
+		__profile_push(sm->owner, PROF_MERGE);
+	pre_merge_hooks[sm->owner](sm);
+	if (option_profile)
+		__profile_pop();
 }
 
 static struct scope_hook_list *pop_scope_hook_list(struct scope_hook_stack **stack)
@@ -333,6 +379,7 @@ void add_scope_hook(scope_hook *fn, void *data)
 	new = __alloc_scope_container(0);
 	new->fn = fn;
 	new->data = data;
+	new->owner = __profile_owner();
 	add_ptr_list(&hook_list, new);
 	push_scope_hook_list(&scope_hooks, hook_list);
 }
@@ -352,7 +399,11 @@ void __call_scope_hooks(void)
 
 	hook_list = pop_scope_hook_list(&scope_hooks);
 	FOR_EACH_PTR(hook_list, tmp) {
+		if (option_profile)
+			__profile_push(tmp->owner, PROF_SCOPE);
 		((scope_hook *) tmp->fn)(tmp->data);
+		if (option_profile)
+			__profile_pop();
 		__free_scope_container(tmp);
 	} END_FOR_EACH_PTR(tmp);
 }
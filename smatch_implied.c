@@ -135,7 +135,7 @@ static int create_fake_history(struct sm_state *sm, int comparison, struct range
 
 	if (rl_intersection(true_rl, false_rl)) {
 		sm_msg("internal error parsing (%s (%s) %s %s)",
-			sm->name, sm->state->name, show_special(comparison), show_rl(rl));
+			sm->name, show_state(sm->state), show_special(comparison), show_rl(rl));
 		sm_msg("true_rl = %s false_rl = %s intersection = %s",
 		       show_rl(true_rl), show_rl(false_rl), show_rl(rl_intersection(true_rl, false_rl)));
 		return 0;
@@ -143,7 +143,7 @@ static int create_fake_history(struct sm_state *sm, int comparison, struct range
 
 	if (option_debug)
 		sm_msg("fake_history: %s vs %s.  %s %s %s. --> T: %s F: %s",
-		       sm->name, show_rl(rl), sm->state->name, show_special(comparison), show_rl(rl),
+		       sm->name, show_rl(rl), show_state(sm->state), show_special(comparison), show_rl(rl),
 		       show_rl(true_rl), show_rl(false_rl));
 
 	true_sm = clone_sm(sm);
@@ -165,6 +165,7 @@ static int create_fake_history(struct sm_state *sm, int comparison, struct range
 	true_sm->pool = true_stree;
 	false_sm->pool = false_stree;
 
+	__pool_generation++;
 	sm->merged = 1;
 	sm->left = true_sm;
 	sm->right = false_sm;
@@ -380,6 +381,110 @@ static void separate_pools(struct sm_state *sm, int comparison, struct range_lis
 	} END_FOR_EACH_PTR(tmp);
 }
 
+/*
+ * The same condition gets checked against the same merged state over and
+ * over (the implied hooks, the case statements, the param limits).  The pool
+ * walk only depends on the gate sm, the comparison and the range list so
+ * remember the last answers.  Anything which gives an sm_state a new pool or
+ * new history bumps __pool_generation and that makes the old answers stale.
+ */
+#define IMPLIED_MEMO_SIZE 256
+static struct implied_memo {
+	struct sm_state *sm;
+	int comparison;
+	int has_mixed;
+	int mixed;
+	unsigned long gen;
+	struct symbol *type;
+	struct range_list *rl;
+	struct state_list *true_stack;
+	struct state_list *false_stack;
+} implied_memo[IMPLIED_MEMO_SIZE];
+
+static unsigned long memo_hits, memo_misses;
+
+void implied_memo_stats(unsigned long *hits, unsigned long *misses)
+{
+	*hits = memo_hits;
+	*misses = memo_misses;
+}
+
+static struct implied_memo *get_memo(struct sm_state *sm, int comparison,
+				      struct symbol *type, int *mixed)
+{
+	unsigned long hash;
+
+	hash = ((unsigned long)sm >> 4) ^ ((unsigned long)type >> 4) ^ comparison ^ !!mixed;
+	return &implied_memo[hash % IMPLIED_MEMO_SIZE];
+}
+
+static void clear_memo(struct implied_memo *memo)
+{
+	free_slist(&memo->true_stack);
+	free_slist(&memo->false_stack);
+	free_rl(&memo->rl);
+	memo->sm = NULL;
+}
+
+static void clear_implied_memo(void)
+{
+	int i;
+
+	for (i = 0; i < IMPLIED_MEMO_SIZE; i++)
+		clear_memo(&implied_memo[i]);
+}
+
+static void memo_separate_pools(struct sm_state *sm, int comparison, struct range_list *rl,
+			struct state_list **true_stack,
+			struct state_list **false_stack,
+			int *mixed)
+{
+	struct implied_memo *memo;
+	struct symbol *type;
+	unsigned long gen;
+
+	/* the debug output is printed during the walk */
+	if (option_debug || option_debug_implied) {
+		separate_pools(sm, comparison, rl, true_stack, false_stack, NULL, mixed);
+		return;
+	}
+
+	gen = __pool_generation;
+	/* rl_equiv() doesn't look at the type but the comparisons do */
+	type = rl_type(rl);
+	memo = get_memo(sm, comparison, type, mixed);
+	if (memo->sm == sm && memo->gen == gen &&
+	    memo->comparison == comparison &&
+	    memo->has_mixed == !!mixed &&
+	    memo->type == type &&
+	    rl_equiv(memo->rl, rl)) {
+		memo_hits++;
+		*true_stack = clone_slist(memo->true_stack);
+		*false_stack = clone_slist(memo->false_stack);
+		if (mixed)
+			*mixed |= memo->mixed;
+		return;
+	}
+	memo_misses++;
+
+	separate_pools(sm, comparison, rl, true_stack, false_stack, NULL, mixed);
+
+	/* creating fake history changes the pools we just walked */
+	if (__pool_generation != gen)
+		return;
+
+	clear_memo(memo);
+	memo->sm = sm;
+	memo->comparison = comparison;
+	memo->has_mixed = !!mixed;
+	memo->mixed = mixed ? *mixed : 0;
+	memo->gen = gen;
+	memo->type = type;
+	memo->rl = clone_rl(rl);
+	memo->true_stack = clone_slist(*true_stack);
+	memo->false_stack = clone_slist(*false_stack);
+}
+
 static int sm_in_keep_leafs(struct sm_state *sm, const struct state_list *keep_gates)
 {
 	struct sm_state *tmp, *old;
@@ -444,8 +549,8 @@ struct sm_state *filter_pools(struct sm_state *sm,
 	DIMPLIED("checking [stree %d] %s from %d (%d) left = %s [stree %d] right = %s [stree %d]\n",
 		 get_stree_id(sm->pool),
 		 show_sm(sm), sm->line, sm->nr_children,
-		 sm->left ? sm->left->state->name : "<none>", sm->left ? get_stree_id(sm->left->pool) : -1,
-		 sm->right ? sm->right->state->name : "<none>", sm->right ? get_stree_id(sm->right->pool) : -1);
+		 sm->left ? show_state(sm->left->state) : "<none>", sm->left ? get_stree_id(sm->left->pool) : -1,
+		 sm->right ? show_state(sm->right->state) : "<none>", sm->right ? get_stree_id(sm->right->pool) : -1);
 	left = filter_pools(sm->left, remove_stack, keep_stack, &removed);
 	right = filter_pools(sm->right, remove_stack, keep_stack, &removed);
 	if (!removed) {
@@ -537,7 +642,7 @@ static void separate_and_filter(struct sm_state *sm, int comparison, struct rang
 		       sm->name, show_special(comparison), show_rl(rl));
 	}
 
-	separate_pools(sm, comparison, rl, &true_stack, &false_stack, NULL, mixed);
+	memo_separate_pools(sm, comparison, rl, &true_stack, &false_stack, mixed);
 
 	DIMPLIED("filtering true stack.\n");
 	*true_states = filter_stack(sm, pre_stree, false_stack, true_stack);
@@ -554,6 +659,7 @@ static void separate_and_filter(struct sm_state *sm, int comparison, struct rang
 
 	gettimeofday(&time_after, NULL);
 	if (time_after.tv_sec - time_before.tv_sec > 20) {
+		__pool_generation++;
 		sm->nr_children = 4000;
 		sm_msg("Function too hairy.  Giving up.");
 	}
@@ -934,6 +1040,7 @@ static void match_end_func(struct symbol *sym)
 	if (__inline_fn)
 		return;
 	implied_debug_msg = NULL;
+	clear_implied_memo();
 }
 
 static void get_tf_stacks_from_pool(struct sm_state *gate_sm,
@@ -947,13 +1054,13 @@ static void get_tf_stacks_from_pool(struct sm_state *gate_sm,
 	if (!gate_sm)
 		return;
 
-	if (strcmp(gate_sm->state->name, pool_sm->state->name) == 0) {
+	if (strcmp(show_state(gate_sm->state), show_state(pool_sm->state)) == 0) {
 		add_ptr_list(true_stack, pool_sm);
 		return;
 	}
 
 	FOR_EACH_PTR(gate_sm->possible, tmp) {
-		if (strcmp(tmp->state->name, pool_sm->state->name) == 0) {
+		if (strcmp(show_state(tmp->state), show_state(pool_sm->state)) == 0) {
 			possibly_true = 1;
 			break;
 		}
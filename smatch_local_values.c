@@ -135,8 +135,7 @@ static void process_states(struct stree *stree)
 		else
 			rl = estate_rl(sm->state);
 		rl = cast_rl(&llong_ctype, rl);
-		mem_sql(NULL, NULL,
-			"insert into local_values values ('%s', '%s', '%s', %lu);",
+		sql_mem_insert("local_values", "'%s', '%s', '%s', %lu",
 			get_filename(), sm->name, show_rl(rl),
 			(unsigned long)sm->sym);
 	} END_FOR_EACH_SM(sm);
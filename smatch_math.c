@@ -1017,13 +1017,111 @@ out_cast:
 	return NULL;
 }
 
+/*
+ * The same expression gets asked about over and over by different checks
+ * while the states stay the same.  Remember the last answers.  An answer
+ * is only good while cur_stree is the same stree and stree_generation
+ * hasn't moved.
+ */
+#define RL_CACHE_SIZE 1024
+static struct rl_cache_entry {
+	struct expression *expr;
+	struct stree *stree;
+	unsigned long gen;
+	int implied;
+	struct range_list *rl;
+} rl_cache[RL_CACHE_SIZE];
+
+static unsigned long rl_cache_hits, rl_cache_misses;
+static unsigned long *owner_hits, *owner_misses;
+
+static void count_rl_cache(int hit)
+{
+	int owner;
+
+	if (hit)
+		rl_cache_hits++;
+	else
+		rl_cache_misses++;
+
+	if (!option_profile)
+		return;
+	if (!owner_hits) {
+		owner_hits = calloc(num_checks + 1, sizeof(*owner_hits));
+		owner_misses = calloc(num_checks + 1, sizeof(*owner_misses));
+	}
+	owner = __profile_owner();
+	if (owner < 0 || owner > num_checks)
+		owner = 0;
+	if (hit)
+		owner_hits[owner]++;
+	else
+		owner_misses[owner]++;
+}
+
+void rl_cache_stats(int owner, unsigned long *hits, unsigned long *misses)
+{
+	if (owner < 0) {
+		*hits = rl_cache_hits;
+		*misses = rl_cache_misses;
+		return;
+	}
+	if (!owner_hits || owner > num_checks) {
+		*hits = 0;
+		*misses = 0;
+		return;
+	}
+	*hits = owner_hits[owner];
+	*misses = owner_misses[owner];
+}
+
+static struct range_list *get_rl_cached(struct expression *expr, int implied)
+{
+	struct rl_cache_entry *entry;
+	struct stree *stree;
+	struct range_list *rl;
+	unsigned long gen;
+	int recurse_cnt = 0;
+
+	/*
+	 * A hit skips the get_state() calls and __get_state_hook() with them.
+	 * That's fine if the miss before it called the hook, but the hook
+	 * ignores fake assignments so they can't fill the cache.
+	 */
+	if (!expr || custom_handle_variable || __in_fake_assign)
+		return _get_rl(expr, implied, &recurse_cnt);
+
+	stree = __get_cur_stree();
+	gen = stree_generation;
+	entry = &rl_cache[(((unsigned long)expr >> 4) ^ implied) % RL_CACHE_SIZE];
+	if (entry->expr == expr && entry->implied == implied &&
+	    entry->stree == stree && entry->gen == gen) {
+		count_rl_cache(1);
+		return clone_rl(entry->rl);
+	}
+	count_rl_cache(0);
+
+	rl = _get_rl(expr, implied, &recurse_cnt);
+
+	/* looking something up can change the states, then don't save it */
+	if (stree_generation != gen || __get_cur_stree() != stree)
+		return rl;
+
+	free_rl(&entry->rl);
+	entry->expr = expr;
+	entry->implied = implied;
+	entry->stree = stree;
+	entry->gen = gen;
+	entry->rl = clone_rl(rl);
+	return rl;
+}
+
 /* returns 1 if it can get a value literal or else returns 0 */
 int get_value(struct expression *expr, sval_t *sval)
 {
 	struct range_list *rl;
-	int recurse_cnt = 0;
 
-	rl = _get_rl(expr, RL_EXACT, &recurse_cnt);
+	rl = get_rl_cached(expr, RL_EXACT);
 	if (!rl_to_sval(rl, sval))
 		return 0;
 	return 1;
@@ -1042,9 +1140,8 @@ static int get_implied_value_internal(struct expression *expr, sval_t *sval, int
 int get_implied_value(struct expression *expr, sval_t *sval)
 {
 	struct range_list *rl;
-	int recurse_cnt = 0;
 
-	rl =  _get_rl(expr, RL_IMPLIED, &recurse_cnt);
+	rl =  get_rl_cached(expr, RL_IMPLIED);
 	if (!rl_to_sval(rl, sval))
 		return 0;
 	return 1;
@@ -1053,9 +1150,8 @@ int get_implied_value(struct expression *expr, sval_t *sval)
 int get_implied_min(struct expression *expr, sval_t *sval)
 {
 	struct range_list *rl;
-	int recurse_cnt = 0;
 
-	rl =  _get_rl(expr, RL_IMPLIED, &recurse_cnt);
+	rl =  get_rl_cached(expr, RL_IMPLIED);
 	if (!rl)
 		return 0;
 	*sval = rl_min(rl);
@@ -1065,9 +1161,8 @@ int get_implied_min(struct expression *expr, sval_t *sval)
 int get_implied_max(struct expression *expr, sval_t *sval)
 {
 	struct range_list *rl;
-	int recurse_cnt = 0;
 
-	rl =  _get_rl(expr, RL_IMPLIED, &recurse_cnt);
+	rl =  get_rl_cached(expr, RL_IMPLIED);
 	if (!rl)
 		return 0;
 	*sval = rl_max(rl);
@@ -1076,9 +1171,7 @@ int get_implied_max(struct expression *expr, sval_t *sval)
 
 int get_implied_rl(struct expression *expr, struct range_list **rl)
 {
-	int recurse_cnt = 0;
-
-	*rl = _get_rl(expr, RL_IMPLIED, &recurse_cnt);
+	*rl = get_rl_cached(expr, RL_IMPLIED);
 	if (*rl)
 		return 1;
 	return 0;
@@ -1094,9 +1187,7 @@ static int get_absolute_rl_internal(struct expression *expr, struct range_list *
 
 int get_absolute_rl(struct expression *expr, struct range_list **rl)
 {
-	int recurse_cnt = 0;
-
-	*rl = _get_rl(expr, RL_ABSOLUTE, &recurse_cnt);
+	*rl = get_rl_cached(expr, RL_ABSOLUTE);
 	if (!*rl)
 		*rl = alloc_whole_rl(get_type(expr));
 	return 1;
@@ -1104,9 +1195,7 @@ int get_absolute_rl(struct expression *expr, struct range_list **rl)
 
 int get_real_absolute_rl(struct expression *expr, struct range_list **rl)
 {
-	int recurse_cnt = 0;
-
-	*rl = _get_rl(expr, RL_REAL_ABSOLUTE, &recurse_cnt);
+	*rl = get_rl_cached(expr, RL_REAL_ABSOLUTE);
 	if (!*rl)
 		*rl = alloc_whole_rl(get_type(expr));
 	return 1;
@@ -1139,9 +1228,8 @@ int get_implied_rl_var_sym(const char *var, struct symbol *sym, struct range_lis
 int get_hard_max(struct expression *expr, sval_t *sval)
 {
 	struct range_list *rl;
-	int recurse_cnt = 0;
 
-	rl =  _get_rl(expr, RL_HARD, &recurse_cnt);
+	rl =  get_rl_cached(expr, RL_HARD);
 	if (!rl)
 		return 0;
 	*sval = rl_max(rl);
@@ -1152,9 +1240,8 @@ int get_fuzzy_min(struct expression *expr, sval_t *sval)
 {
 	struct range_list *rl;
 	sval_t tmp;
-	int recurse_cnt = 0;
 
-	rl =  _get_rl(expr, RL_FUZZY, &recurse_cnt);
+	rl =  get_rl_cached(expr, RL_FUZZY);
 	if (!rl)
 		return 0;
 	tmp = rl_min(rl);
@@ -1168,9 +1255,8 @@ int get_fuzzy_max(struct expression *expr, sval_t *sval)
 {
 	struct range_list *rl;
 	sval_t max;
-	int recurse_cnt = 0;
 
-	rl =  _get_rl(expr, RL_FUZZY, &recurse_cnt);
+	rl =  get_rl_cached(expr, RL_FUZZY);
 	if (!rl)
 		return 0;
 	max = rl_max(rl);
@@ -1184,12 +1270,11 @@ int get_absolute_min(struct expression *expr, sval_t *sval)
 {
 	struct range_list *rl;
 	struct symbol *type;
-	int recurse_cnt = 0;
 
 	type = get_type(expr);
 	if (!type)
 		type = &llong_ctype;  // FIXME: this is wrong but places assume get type can't fail.
-	rl = _get_rl(expr, RL_ABSOLUTE, &recurse_cnt);
+	rl = get_rl_cached(expr, RL_ABSOLUTE);
 	if (rl)
 		*sval = rl_min(rl);
 	else
@@ -1204,12 +1289,11 @@ int get_absolute_max(struct expression *expr, sval_t *sval)
 {
 	struct range_list *rl;
 	struct symbol *type;
-	int recurse_cnt = 0;
 
 	type = get_type(expr);
 	if (!type)
 		type = &llong_ctype;
-	rl = _get_rl(expr, RL_ABSOLUTE, &recurse_cnt);
+	rl = get_rl_cached(expr, RL_ABSOLUTE);
 	if (rl)
 		*sval = rl_max(rl);
 	else
@@ -30,6 +30,8 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <sys/time.h>
+#include "bitmap.h"
 #include "smatch.h"
 #include "smatch_extra.h"
 #include "smatch_slist.h"
@@ -53,6 +55,10 @@ static modification_hook **indirect_hooks_late;  /* parent struct modified etc *
 
 ALLOCATOR(modification_data, "modification data");
 
+static unsigned long hook_calls;
+static unsigned long hook_visited;
+static unsigned long hook_usec;
+
 static int my_id;
 static struct smatch_state *alloc_my_state(struct expression *expr, struct smatch_state *prev)
 {
@@ -119,36 +125,103 @@ static int matches(char *name, struct symbol *sym, struct sm_state *sm)
 	return match_none;
 }
 
-static void call_modification_hooks_name_sym(char *name, struct symbol *sym, struct expression *mod_expr, int late)
+static int has_hooks(int owner)
+{
+	return hooks[owner] || indirect_hooks[owner] ||
+	       hooks_late[owner] || indirect_hooks_late[owner];
+}
+
+static void call_hooks(struct sm_state *sm, int match, struct expression *mod_expr, int late)
+{
+	if (late == EARLY || late == BOTH) {
+		if (hooks[sm->owner])
+			(hooks[sm->owner])(sm, mod_expr);
+		if (match == match_indirect && indirect_hooks[sm->owner])
+			(indirect_hooks[sm->owner])(sm, mod_expr);
+	}
+	if (late == LATE || late == BOTH) {
+		if (hooks_late[sm->owner])
+			(hooks_late[sm->owner])(sm, mod_expr);
+		if (match == match_indirect && indirect_hooks_late[sm->owner])
+			(indirect_hooks_late[sm->owner])(sm, mod_expr);
+	}
+}
+
+/*
+ * The stree is sorted by owner and then by name so everything that
+ * matches() could match is in two runs for each owner: the names which
+ * start with "name" and the names which start with "*name".
+ */
+static void call_hooks_prefix(int owner, const char *prefix, char *name, struct symbol *sym,
+			      struct expression *mod_expr, int late)
 {
 	struct sm_state *sm;
-	struct smatch_state *prev;
+	AvlIter iter;
+	int len = strlen(prefix);
 	int match;
 
-	prev = get_state(my_id, name, sym);
-	set_state(my_id, name, sym, alloc_my_state(mod_expr, prev));
-
-	FOR_EACH_SM(__get_cur_stree(), sm) {
-		if (sm->owner > num_checks)
-			continue;
+	for (avl_iter_seek(&iter, __get_cur_stree(), owner, prefix);
+	     iter.node;
+	     avl_iter_next(&iter)) {
+		sm = iter.sm;
+		hook_visited++;
+		if (sm->owner != owner || strncmp(sm->name, prefix, len) != 0)
+			break;
 		match = matches(name, sym, sm);
 		if (!match)
 			continue;
+		call_hooks(sm, match, mod_expr, late);
+	}
+}
 
-		if (late == EARLY || late == BOTH) {
-			if (hooks[sm->owner])
-				(hooks[sm->owner])(sm, mod_expr);
-			if (match == match_indirect && indirect_hooks[sm->owner])
-				(indirect_hooks[sm->owner])(sm, mod_expr);
-		}
-		if (late == LATE || late == BOTH) {
-			if (hooks_late[sm->owner])
-				(hooks_late[sm->owner])(sm, mod_expr);
-			if (match == match_indirect && indirect_hooks_late[sm->owner])
-				(indirect_hooks_late[sm->owner])(sm, mod_expr);
+static void call_modification_hooks_name_sym(char *name, struct symbol *sym, struct expression *mod_expr, int late)
+{
+	struct timeval start, stop;
+	struct smatch_state *prev;
+	unsigned long *owners;
+	char *star_name;
+	int owner;
+
+	if (option_time)
+		gettimeofday(&start, NULL);
+
+	prev = get_state(my_id, name, sym);
+	set_state(my_id, name, sym, alloc_my_state(mod_expr, prev));
+
+	owners = get_sym_owners(sym);
+	if (!owners)
+		goto done;
+
+	star_name = malloc(strlen(name) + 2);
+	star_name[0] = '*';
+	strcpy(star_name + 1, name);
+
+	/* the same order as walking the whole stree */
+	for (owner = num_checks; owner >= 0; owner--) {
+		if (!test_bit(owner, owners) || !has_hooks(owner))
+			continue;
+		if (strcmp(star_name, name) < 0) {
+			call_hooks_prefix(owner, star_name, name, sym, mod_expr, late);
+			call_hooks_prefix(owner, name, name, sym, mod_expr, late);
+		} else {
+			call_hooks_prefix(owner, name, name, sym, mod_expr, late);
+			call_hooks_prefix(owner, star_name, name, sym, mod_expr, late);
 		}
+	}
+	free(star_name);
+done:
+	if (option_time) {
+		gettimeofday(&stop, NULL);
+		hook_calls++;
+		hook_usec += (stop.tv_sec - start.tv_sec) * 1000000 +
+			     stop.tv_usec - start.tv_usec;
+	}
+}
 
-	} END_FOR_EACH_SM(sm);
+void modification_hook_stats(void)
+{
+	sm_msg("modification hooks: %lu calls %lu states visited %lu ms",
+	       hook_calls, hook_visited, hook_usec / 1000);
 }
 
 static void call_modification_hooks(struct expression *expr, struct expression *mod_expr, int late)
@@ -127,7 +127,7 @@ static void print_return_value_param(int return_id, char *return_ranges, struct
 			continue;
 
 		sql_insert_return_states(return_id, return_ranges, PARAM_LIMIT,
-					 param, param_name, state->name);
+					 param, param_name, show_state(state));
 	} END_FOR_EACH_SM(tmp);
 }
 
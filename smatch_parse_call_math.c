@@ -587,7 +587,7 @@ static void print_returned_allocations(int return_id, char *return_ranges, struc
 		goto free;
 
 	sql_insert_return_states(return_id, return_ranges, BUF_SIZE, -1, "",
-			state->name);
+			show_state(state));
 free:
 	free_string(name);
 }
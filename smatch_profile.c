@@ -0,0 +1,422 @@
+/*
+ * Copyright (C) 2016 Oracle.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see http://www.gnu.org/copyleft/gpl.txt
+ */
+
+/*
+ * --profile records how long every hook takes.  The time is counted for
+ * the check which registered the hook and the type of hook.  Hooks call
+ * other hooks so each frame only counts its own time, not the time of the
+ * hooks inside it.
+ *
+ * At the end of each file we print the report and write it to
+ * file.c.smatch_profile as JSON.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "smatch.h"
+#include "smatch_slist.h"
+
+static const char *hook_names[PROF_NUM] = {
+	[EXPR_HOOK] = "EXPR_HOOK",
+	[STMT_HOOK] = "STMT_HOOK",
+	[STMT_HOOK_AFTER] = "STMT_HOOK_AFTER",
+	[SYM_HOOK] = "SYM_HOOK",
+	[STRING_HOOK] = "STRING_HOOK",
+	[DECLARATION_HOOK] = "DECLARATION_HOOK",
+	[ASSIGNMENT_HOOK] = "ASSIGNMENT_HOOK",
+	[RAW_ASSIGNMENT_HOOK] = "RAW_ASSIGNMENT_HOOK",
+	[GLOBAL_ASSIGNMENT_HOOK] = "GLOBAL_ASSIGNMENT_HOOK",
+	[LOGIC_HOOK] = "LOGIC_HOOK",
+	[CONDITION_HOOK] = "CONDITION_HOOK",
+	[PRELOOP_HOOK] = "PRELOOP_HOOK",
+	[SELECT_HOOK] = "SELECT_HOOK",
+	[WHOLE_CONDITION_HOOK] = "WHOLE_CONDITION_HOOK",
+	[FUNCTION_CALL_HOOK] = "FUNCTION_CALL_HOOK",
+	[CALL_HOOK_AFTER_INLINE] = "CALL_HOOK_AFTER_INLINE",
+	[FUNCTION_CALL_HOOK_AFTER_DB] = "FUNCTION_CALL_HOOK_AFTER_DB",
+	[CALL_ASSIGNMENT_HOOK] = "CALL_ASSIGNMENT_HOOK",
+	[MACRO_ASSIGNMENT_HOOK] = "MACRO_ASSIGNMENT_HOOK",
+	[BINOP_HOOK] = "BINOP_HOOK",
+	[OP_HOOK] = "OP_HOOK",
+	[DEREF_HOOK] = "DEREF_HOOK",
+	[CASE_HOOK] = "CASE_HOOK",
+	[ASM_HOOK] = "ASM_HOOK",
+	[CAST_HOOK] = "CAST_HOOK",
+	[SIZEOF_HOOK] = "SIZEOF_HOOK",
+	[BASE_HOOK] = "BASE_HOOK",
+	[FUNC_DEF_HOOK] = "FUNC_DEF_HOOK",
+	[AFTER_DEF_HOOK] = "AFTER_DEF_HOOK",
+	[END_FUNC_HOOK] = "END_FUNC_HOOK",
+	[AFTER_FUNC_HOOK] = "AFTER_FUNC_HOOK",
+	[RETURN_HOOK] = "RETURN_HOOK",
+	[INLINE_FN_START] = "INLINE_FN_START",
+	[INLINE_FN_END] = "INLINE_FN_END",
+	[END_FILE_HOOK] = "END_FILE_HOOK",
+	[PROF_MERGE] = "merge",
+	[PROF_UNMATCHED] = "unmatched_state",
+	[PROF_SQL] = "sql",
+	[PROF_MEM_SQL] = "mem_sql",
+	[PROF_SCOPE] = "scope",
+	[PROF_FUNCTION_HOOK] = "function_hook",
+};
+
+struct prof_count {
+	unsigned long calls;
+	unsigned long long nsec;
+};
+static struct prof_count *counts;  /* [owner * PROF_NUM + type] */
+
+struct prof_frame {
+	unsigned long long start;
+	unsigned long long child;
+	int owner;
+	int type;
+};
+#define MAX_DEPTH 256
+static struct prof_frame stack[MAX_DEPTH];
+static int depth;
+
+struct fn_time {
+	char *name;
+	unsigned long long nsec;
+};
+static struct fn_time *fn_times;
+static int fn_times_used;
+static int fn_times_size;
+static unsigned long long fn_start;
+
+/*
+ * The caches and the arena count from the start of the run so the report
+ * prints the difference from where they were at the last report.
+ */
+enum {
+	RS_HITS, RS_MISSES, MEMO_HITS, MEMO_MISSES, ARENA_RELEASES,
+	RL_HITS, RL_MISSES, NUM_STATS
+};
+enum { OWNER_WIDENED, OWNER_RL_HITS, OWNER_RL_MISSES, NUM_OWNER_STATS };
+static unsigned long *stats;  /* this file */
+static unsigned long *stats_base;  /* the totals at the last report */
+#define OWNER_STAT(owner, stat) stats[NUM_STATS + (owner) * NUM_OWNER_STATS + (stat)]
+
+static unsigned long long now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static struct prof_count *get_count(int owner, int type)
+{
+	if (!counts)
+		counts = calloc((num_checks + 1) * PROF_NUM, sizeof(*counts));
+	if (owner < 0 || owner > num_checks)
+		owner = 0;
+	return &counts[owner * PROF_NUM + type];
+}
+
+void __profile_push(int owner, int type)
+{
+	struct prof_frame *frame;
+
+	if (depth < MAX_DEPTH) {
+		frame = &stack[depth];
+		frame->owner = owner;
+		frame->type = type;
+		frame->child = 0;
+		frame->start = now();
+	}
+	depth++;
+}
+
+void __profile_pop(void)
+{
+	struct prof_frame *frame;
+	struct prof_count *count;
+	unsigned long long elapsed;
+
+	depth--;
+	if (depth >= MAX_DEPTH)
+		return;
+
+	frame = &stack[depth];
+	elapsed = now() - frame->start;
+	count = get_count(frame->owner, frame->type);
+	count->calls++;
+	count->nsec += elapsed - frame->child;
+	if (depth > 0)
+		stack[depth - 1].child += elapsed;
+}
+
+/* the SQL is counted for the check which asked for it */
+int __profile_owner(void)
+{
+	if (depth == 0)
+		return 0;
+	if (depth > MAX_DEPTH)
+		return stack[MAX_DEPTH - 1].owner;
+	return stack[depth - 1].owner;
+}
+
+void __profile_start_function(void)
+{
+	fn_start = now();
+}
+
+void __profile_end_function(const char *name)
+{
+	if (fn_times_used == fn_times_size) {
+		fn_times_size = fn_times_size ? fn_times_size * 2 : 256;
+		fn_times = realloc(fn_times, fn_times_size * sizeof(*fn_times));
+	}
+	fn_times[fn_times_used].name = alloc_string(name ? name : "");
+	fn_times[fn_times_used].nsec = now() - fn_start;
+	fn_times_used++;
+}
+
+static const char *owner_name(int owner)
+{
+	const char *name;
+
+	name = check_name(owner);
+	if (!name)
+		return "internal";
+	return name;
+}
+
+static int cmp_counts(const void *_a, const void *_b)
+{
+	const struct prof_count *a = *(const struct prof_count **)_a;
+	const struct prof_count *b = *(const struct prof_count **)_b;
+
+	if (a->nsec > b->nsec)
+		return -1;
+	if (a->nsec < b->nsec)
+		return 1;
+	return 0;
+}
+
+static int cmp_fn_times(const void *_a, const void *_b)
+{
+	const struct fn_time *a = _a;
+	const struct fn_time *b = _b;
+
+	if (a->nsec > b->nsec)
+		return -1;
+	if (a->nsec < b->nsec)
+		return 1;
+	return 0;
+}
+
+static void count_to_owner_type(struct prof_count *count, int *owner, int *type)
+{
+	int idx = count - counts;
+
+	*owner = idx / PROF_NUM;
+	*type = idx % PROF_NUM;
+}
+
+static struct prof_count **sorted_counts(int *nr)
+{
+	struct prof_count **sorted;
+	int i, total;
+
+	total = (num_checks + 1) * PROF_NUM;
+	sorted = malloc(total * sizeof(*sorted));
+	*nr = 0;
+	for (i = 0; i < total; i++) {
+		if (counts[i].calls)
+			sorted[(*nr)++] = &counts[i];
+	}
+	qsort(sorted, *nr, sizeof(*sorted), cmp_counts);
+	return sorted;
+}
+
+static int nr_stats(void)
+{
+	return NUM_STATS + (num_checks + 1) * NUM_OWNER_STATS;
+}
+
+static void read_totals(unsigned long *vals)
+{
+	unsigned long *p;
+	int owner;
+
+	return_states_cache_stats(&vals[RS_HITS], &vals[RS_MISSES]);
+	implied_memo_stats(&vals[MEMO_HITS], &vals[MEMO_MISSES]);
+	vals[ARENA_RELEASES] = function_arena.releases;
+	rl_cache_stats(-1, &vals[RL_HITS], &vals[RL_MISSES]);
+	for (owner = 0; owner <= num_checks; owner++) {
+		p = &vals[NUM_STATS + owner * NUM_OWNER_STATS];
+		p[OWNER_WIDENED] = possible_widen_count(owner);
+		rl_cache_stats(owner, &p[OWNER_RL_HITS], &p[OWNER_RL_MISSES]);
+	}
+}
+
+static void read_file_stats(void)
+{
+	unsigned long *totals;
+	int i;
+
+	if (!stats) {
+		stats = calloc(nr_stats(), sizeof(*stats));
+		stats_base = calloc(nr_stats(), sizeof(*stats_base));
+	}
+	totals = calloc(nr_stats(), sizeof(*totals));
+	read_totals(totals);
+	for (i = 0; i < nr_stats(); i++)
+		stats[i] = totals[i] - stats_base[i];
+	free(stats_base);
+	stats_base = totals;
+}
+
+static void print_json_string(FILE *f, const char *str)
+{
+	fputc('"', f);
+	for (; *str; str++) {
+		if (*str == '"' || *str == '\\')
+			fputc('\\', f);
+		fputc(*str, f);
+	}
+	fputc('"', f);
+}
+
+static void write_json(const char *file, struct prof_count **sorted, int nr)
+{
+	char buf[256];
+	FILE *f;
+	int owner, type;
+	int i;
+
+	snprintf(buf, sizeof(buf), "%s.smatch_profile", file);
+	f = fopen(buf, "w");
+	if (!f) {
+		printf("Error:  Cannot open %s\n", buf);
+		return;
+	}
+
+	fprintf(f, "{\n  \"file\": ");
+	print_json_string(f, file);
+	fprintf(f, ",\n  \"hooks\": [");
+	for (i = 0; i < nr; i++) {
+		count_to_owner_type(sorted[i], &owner, &type);
+		fprintf(f, "%s\n    {\"check\": \"%s\", \"hook\": \"%s\", \"calls\": %lu, \"nsec\": %llu}",
+			i ? "," : "", owner_name(owner), hook_names[type],
+			sorted[i]->calls, sorted[i]->nsec);
+	}
+	fprintf(f, "\n  ],\n  \"functions\": [");
+	for (i = 0; i < fn_times_used; i++) {
+		fprintf(f, "%s\n    {\"function\": ", i ? "," : "");
+		print_json_string(f, fn_times[i].name);
+		fprintf(f, ", \"nsec\": %llu}", fn_times[i].nsec);
+	}
+	fprintf(f, "\n  ],\n  \"possible_widened\": [");
+	for (owner = 0, i = 0; owner <= num_checks; owner++) {
+		if (!OWNER_STAT(owner, OWNER_WIDENED))
+			continue;
+		fprintf(f, "%s\n    {\"check\": \"%s\", \"count\": %lu}",
+			i++ ? "," : "", owner_name(owner), OWNER_STAT(owner, OWNER_WIDENED));
+	}
+	fprintf(f, "\n  ],\n  \"rl_cache\": [");
+	for (owner = 0, i = 0; owner <= num_checks; owner++) {
+		if (!OWNER_STAT(owner, OWNER_RL_HITS) && !OWNER_STAT(owner, OWNER_RL_MISSES))
+			continue;
+		fprintf(f, "%s\n    {\"check\": \"%s\", \"hits\": %lu, \"misses\": %lu}",
+			i++ ? "," : "", owner_name(owner), OWNER_STAT(owner, OWNER_RL_HITS),
+			OWNER_STAT(owner, OWNER_RL_MISSES));
+	}
+	fprintf(f, "\n  ],\n  \"return_states_cache\": {\"hits\": %lu, \"misses\": %lu},\n",
+		stats[RS_HITS], stats[RS_MISSES]);
+	fprintf(f, "  \"implied_memo\": {\"hits\": %lu, \"misses\": %lu},\n",
+		stats[MEMO_HITS], stats[MEMO_MISSES]);
+	/* the high water mark and the kept bytes are for the whole run */
+	fprintf(f, "  \"function_arena\": {\"releases\": %lu, \"run_high_water\": %lu, \"kept\": %lu}\n}\n",
+		stats[ARENA_RELEASES], function_arena.high_water,
+		function_arena.free_bytes);
+	fclose(f);
+}
+
+static void clear_profile(void)
+{
+	int i;
+
+	memset(counts, 0, (num_checks + 1) * PROF_NUM * sizeof(*counts));
+	for (i = 0; i < fn_times_used; i++)
+		free_string(fn_times[i].name);
+	fn_times_used = 0;
+}
+
+void __profile_report(const char *file)
+{
+	struct prof_count **sorted;
+	unsigned long long total = 0;
+	unsigned long hits, misses;
+	int owner, type;
+	int nr, i;
+
+	if (!counts)
+		return;
+
+	read_file_stats();
+
+	sorted = sorted_counts(&nr);
+	for (i = 0; i < nr; i++)
+		total += sorted[i]->nsec;
+	qsort(fn_times, fn_times_used, sizeof(*fn_times), cmp_fn_times);
+
+	fprintf(sm_outfd, "%s: profile: %llu ms in hooks\n", file, total / 1000000);
+	for (i = 0; i < nr && i < 40; i++) {
+		count_to_owner_type(sorted[i], &owner, &type);
+		fprintf(sm_outfd, "%s: profile: %8.2f ms %5.1f%% %9lu calls  %s %s\n",
+			file, sorted[i]->nsec / 1000000.0,
+			total ? sorted[i]->nsec * 100.0 / total : 0.0,
+			sorted[i]->calls, owner_name(owner), hook_names[type]);
+	}
+	for (i = 0; i < fn_times_used && i < 10; i++) {
+		fprintf(sm_outfd, "%s: profile: %8.2f ms  function %s()\n",
+			file, fn_times[i].nsec / 1000000.0, fn_times[i].name);
+	}
+
+	fprintf(sm_outfd, "%s: profile: return_states cache %lu hits %lu misses\n",
+		file, stats[RS_HITS], stats[RS_MISSES]);
+	fprintf(sm_outfd, "%s: profile: implied pool walks saved %lu of %lu\n",
+		file, stats[MEMO_HITS], stats[MEMO_HITS] + stats[MEMO_MISSES]);
+	fprintf(sm_outfd, "%s: profile: %lu functions, function arena high water %lu KB for the whole run\n",
+		file, stats[ARENA_RELEASES], function_arena.high_water / 1024);
+	for (owner = 0; owner <= num_checks; owner++) {
+		if (!OWNER_STAT(owner, OWNER_WIDENED))
+			continue;
+		fprintf(sm_outfd, "%s: profile: possible states widened %lu times  %s\n",
+			file, OWNER_STAT(owner, OWNER_WIDENED), owner_name(owner));
+	}
+	fprintf(sm_outfd, "%s: profile: range list cache %lu hits %lu misses\n",
+		file, stats[RL_HITS], stats[RL_MISSES]);
+	for (owner = 0; owner <= num_checks; owner++) {
+		hits = OWNER_STAT(owner, OWNER_RL_HITS);
+		misses = OWNER_STAT(owner, OWNER_RL_MISSES);
+		if (!hits && !misses)
+			continue;
+		fprintf(sm_outfd, "%s: profile: range list cache %5.1f%% of %lu  %s\n",
+			file, hits * 100.0 / (hits + misses), hits + misses,
+			owner_name(owner));
+	}
+
+	write_json(file, sorted, nr);
+	free(sorted);
+	clear_profile();
+}
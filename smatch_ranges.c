@@ -20,8 +20,10 @@
 #include "smatch_extra.h"
 #include "smatch_slist.h"
 
-ALLOCATOR(data_info, "smatch extra data");
-ALLOCATOR(data_range, "data range");
+static void free_single_dinfo(void *entry);
+
+ARENA_ALLOCATOR(data_info, "smatch extra data", &function_arena, &free_single_dinfo);
+ARENA_ALLOCATOR(data_range, "data range", &function_arena, NULL);
 __DO_ALLOCATOR(struct data_range, sizeof(struct data_range), __alignof__(struct data_range),
 			 "permanent ranges", perm_data_range);
 
@@ -425,12 +427,72 @@ static void str_to_rl_helper(struct expression *call, struct symbol *type, char
 	*endp = c;
 }
 
+/*
+ * The same range strings come out of the database over and over.  When a
+ * string doesn't depend on the call (no [...] parts) then the parsed ranges
+ * only depend on the type so we save them as a flat array of data_ranges.
+ * It's a direct mapped cache so it never gets bigger than RL_CACHE_SIZE.
+ */
+#define RL_CACHE_SIZE 4096
+
+struct rl_cache {
+	struct symbol *type;
+	char *str;
+	int nr;
+	struct data_range *ranges;
+};
+static struct rl_cache rl_cache[RL_CACHE_SIZE];
+
+static struct rl_cache *get_rl_cache(struct symbol *type, const char *str)
+{
+	unsigned int hash = (unsigned long)type >> 4;
+
+	while (*str)
+		hash = hash * 33 + (unsigned char)*str++;
+	return &rl_cache[hash & (RL_CACHE_SIZE - 1)];
+}
+
+static int get_cached_rl(struct symbol *type, const char *str, struct range_list **rl)
+{
+	struct rl_cache *cache = get_rl_cache(type, str);
+	struct data_range *new;
+	int i;
+
+	if (cache->type != type || !cache->str || strcmp(cache->str, str) != 0)
+		return 0;
+
+	*rl = NULL;
+	for (i = 0; i < cache->nr; i++) {
+		new = alloc_range(cache->ranges[i].min, cache->ranges[i].max);
+		add_ptr_list(rl, new);
+	}
+	return 1;
+}
+
+static void set_cached_rl(struct symbol *type, const char *str, struct range_list *rl)
+{
+	struct rl_cache *cache = get_rl_cache(type, str);
+	struct data_range *tmp;
+	int i = 0;
+
+	free(cache->str);
+	free(cache->ranges);
+	cache->type = type;
+	cache->str = strdup(str);
+	cache->nr = ptr_list_size((struct ptr_list *)rl);
+	cache->ranges = malloc(cache->nr * sizeof(*cache->ranges));
+	FOR_EACH_PTR(rl, tmp) {
+		cache->ranges[i++] = *tmp;
+	} END_FOR_EACH_PTR(tmp);
+}
+
 static void str_to_dinfo(struct expression *call, struct symbol *type, char *value, struct data_info *dinfo)
 {
 	struct range_list *math_rl;
 	char *call_math;
 	char *c;
 	struct range_list *rl = NULL;
+	int cache;
 
 	if (!type)
 		type = &llong_ctype;
@@ -438,6 +500,11 @@ static void str_to_dinfo(struct expression *call, struct symbol *type, char *val
 	if (strcmp(value, "empty") == 0)
 		return;
 
+	/* anything in [...] depends on the call, even in "0-[<=$1]" */
+	cache = !strchr(value, '[');
+	if (cache && get_cached_rl(type, value, &dinfo->value_ranges))
+		return;
+
 	if (strncmp(value, "[==$", 4) == 0) {
 		struct expression *arg;
 		int comparison;
@@ -471,6 +538,8 @@ static void str_to_dinfo(struct expression *call, struct symbol *type, char *val
 cast:
 	rl = cast_rl(type, rl);
 	dinfo->value_ranges = rl;
+	if (cache)
+		set_cached_rl(type, value, rl);
 }
 
 void str_to_rl(struct symbol *type, char *value, struct range_list **rl)
@@ -1553,39 +1622,11 @@ void free_rl(struct range_list **rlist)
 	__free_ptr_list((struct ptr_list **)rlist);
 }
 
-static void free_single_dinfo(struct data_info *dinfo)
-{
-	free_rl(&dinfo->value_ranges);
-}
-
-static void free_dinfos(struct allocation_blob *blob)
-{
-	unsigned int size = sizeof(struct data_info);
-	unsigned int offset = 0;
-
-	while (offset < blob->offset) {
-		free_single_dinfo((struct data_info *)(blob->data + offset));
-		offset += size;
-	}
-}
-
-void free_data_info_allocs(void)
+static void free_single_dinfo(void *entry)
 {
-	struct allocator_struct *desc = &data_info_allocator;
-	struct allocation_blob *blob = desc->blobs;
+	struct data_info *dinfo = entry;
 
-	desc->blobs = NULL;
-	desc->allocations = 0;
-	desc->total_bytes = 0;
-	desc->useful_bytes = 0;
-	desc->freelist = NULL;
-	while (blob) {
-		struct allocation_blob *next = blob->next;
-		free_dinfos(blob);
-		blob_free(blob, desc->chunking);
-		blob = next;
-	}
-	clear_data_range_alloc();
+	free_rl(&dinfo->value_ranges);
 }
 
 void split_comparison_rl(struct range_list *left_orig, int op, struct range_list *right_orig,
@@ -28,7 +28,7 @@ fi
 # required packages are installed
 if [ ! -e smatch_db.sqlite ] ; then
     [ -e smatch_warns.txt ] || touch smatch_warns.txt
-    if ! $DATA_DIR/db/create_db.sh -p=kernel smatch_warns.txt ; then
+    if ! $DATA_DIR/db/create_db.sh --smatch=$CMD -p=kernel smatch_warns.txt ; then
         echo "Hm... Not working.  Make sure you have all the sqlite3 packages"
         echo "And the sqlite3 libraries for Perl and Python"
         exit 1
@@ -43,5 +43,5 @@ done
 
 mv ${PROJECT}.* $DATA_DIR
 
-$DATA_DIR/db/create_db.sh -p=kernel smatch_warns.txt
+$DATA_DIR/db/create_db.sh --smatch=$CMD -p=kernel smatch_warns.txt
 
@@ -4,8 +4,9 @@ NR_CPU=$(cat /proc/cpuinfo | grep ^processor | wc -l)
 
 function usage {
     echo
-    echo "Usage:  $0 [smatch options]"
+    echo "Usage:  $0 [--server] [smatch options]"
     echo "Compiles the kernel with -j${NR_CPU}"
+    echo "--server:  start Smatch once and have each file checked by it."
     echo
     exit 1
 }
@@ -14,6 +15,12 @@ if [ "$1" = "-h" ] || [ "$1" = "--help" ] ; then
 	usage;
 fi
 
+SERVER=""
+if [ "$1" = "--server" ] ; then
+    SERVER=yes
+    shift
+fi
+
 SCRIPT_DIR=$(dirname $0)
 if [ -e $SCRIPT_DIR/../smatch ] ; then
     cp $SCRIPT_DIR/../smatch $SCRIPT_DIR/../bak.smatch
@@ -25,10 +32,33 @@ else
     exit 1
 fi
 
+CHECK="$CMD -p=kernel --file-output $*"
+if [ "$SERVER" != "" ] ; then
+    SOCK=$(mktemp -u /tmp/smatch_sock.XXXXXX)
+    $CMD -p=kernel $* --server=$SOCK &
+    SERVER_PID=$!
+    trap "kill $SERVER_PID 2> /dev/null ; rm -f $SOCK" EXIT
+    trap "exit 1" INT TERM
+    while [ ! -S $SOCK ] ; do
+        if ! kill -0 $SERVER_PID 2> /dev/null ; then
+            echo "The Smatch server failed to start."
+            exit 1
+        fi
+        sleep 1
+    done
+    CHECK="$CMD --client=$SOCK -p=kernel --file-output $*"
+fi
+
 make clean
 find -name \*.c.smatch -exec rm \{\} \;
-make -j${NR_CPU} -k CHECK="$CMD -p=kernel --file-output $*" \
+make -j${NR_CPU} -k CHECK="$CHECK" \
 	C=1 bzImage modules 2>&1 | tee smatch_compile.warns
+
+if [ "$SERVER" != "" ] ; then
+    kill $SERVER_PID
+    rm -f $SOCK
+    trap - EXIT
+fi
 find -name \*.c.smatch -exec cat \{\} \; -exec rm \{\} \; > smatch_warns.txt
 
 echo "Done.  The warnings are saved to smatch_warns.txt"
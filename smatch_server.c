@@ -0,0 +1,329 @@
+/*
+ * Copyright (C) 2016 Oracle.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see http://www.gnu.org/copyleft/gpl.txt
+ */
+
+/*
+ * Every time Smatch starts it reads the smatch_data/ files, opens the
+ * database and registers all the checks before it looks at the first line
+ * of code.  When the kernel build runs Smatch once per file that adds up.
+ *
+ * smatch -p=kernel --server=/tmp/smatch.sock &
+ * make CHECK="smatch --client=/tmp/smatch.sock -p=kernel --file-output" C=1
+ *
+ * The server does the start up work once and then waits on a unix socket.
+ * The client sends its working directory and its arguments along with its
+ * stdout and stderr.  For each client the server forks a child which
+ * checks the file and writes straight to the client's stdout and stderr.
+ * When the child is done the exit status is sent back to the client.
+ *
+ * The children only read smatch_db.sqlite and the server never touches it
+ * after the first fork, so sharing the connection is fine.  The server has
+ * to be started in the directory where smatch_db.sqlite is.
+ *
+ * The options which decide what gets registered (-p, --data, --no-data,
+ * --no-db, --enable, --spammy, --info and so on) are only looked at when
+ * the server starts.  A client has to pass the same ones or it's refused.
+ *
+ * The socket is only for the user who started the server.
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include "smatch.h"
+
+static int fill_addr(struct sockaddr_un *addr, const char *path)
+{
+	memset(addr, 0, sizeof(*addr));
+	addr->sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(addr->sun_path)) {
+		fprintf(stderr, "smatch: socket path too long: %s\n", path);
+		return -1;
+	}
+	strcpy(addr->sun_path, path);
+	return 0;
+}
+
+static int write_all(int fd, const char *buf, size_t len)
+{
+	ssize_t ret;
+
+	while (len) {
+		ret = write(fd, buf, len);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret <= 0)
+			return -1;
+		buf += ret;
+		len -= ret;
+	}
+	return 0;
+}
+
+/*
+ * The request is the working directory and the arguments, each one NUL
+ * terminated.  The client's stdout and stderr come with the first byte.
+ */
+static int send_request(int sock, int argc, char **argv)
+{
+	char cmsg_buf[CMSG_SPACE(2 * sizeof(int))];
+	struct cmsghdr *cmsg;
+	struct msghdr msg;
+	struct iovec iov;
+	char cwd[PATH_MAX];
+	int fds[2] = { 1, 2 };
+	int i;
+
+	if (!getcwd(cwd, sizeof(cwd)))
+		return -1;
+
+	memset(&msg, 0, sizeof(msg));
+	memset(cmsg_buf, 0, sizeof(cmsg_buf));
+	iov.iov_base = cwd;
+	iov.iov_len = 1;
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = cmsg_buf;
+	msg.msg_controllen = sizeof(cmsg_buf);
+	cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+	memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+	if (sendmsg(sock, &msg, 0) != 1)
+		return -1;
+	if (write_all(sock, cwd + 1, strlen(cwd)) < 0)
+		return -1;
+	for (i = 0; i < argc; i++) {
+		if (write_all(sock, argv[i], strlen(argv[i]) + 1) < 0)
+			return -1;
+	}
+	shutdown(sock, SHUT_WR);
+	return 0;
+}
+
+int smatch_client(const char *path, int argc, char **argv)
+{
+	struct sockaddr_un addr;
+	unsigned char status;
+	ssize_t ret;
+	int sock;
+
+	if (fill_addr(&addr, path))
+		return 1;
+	sock = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (sock < 0 || connect(sock, (struct sockaddr *)&addr, sizeof(addr))) {
+		fprintf(stderr, "smatch: cannot connect to %s: %s\n", path, strerror(errno));
+		return 1;
+	}
+	fflush(stdout);
+	fflush(stderr);
+	if (send_request(sock, argc, argv)) {
+		fprintf(stderr, "smatch: cannot send to %s\n", path);
+		return 1;
+	}
+
+	do {
+		ret = read(sock, &status, 1);
+	} while (ret < 0 && errno == EINTR);
+	close(sock);
+	if (ret != 1) {
+		fprintf(stderr, "smatch: the server went away\n");
+		return 1;
+	}
+	return status;
+}
+
+static char *read_request(int sock, int fds[2], size_t *len)
+{
+	char cmsg_buf[CMSG_SPACE(2 * sizeof(int))];
+	struct cmsghdr *cmsg;
+	struct msghdr msg;
+	struct iovec iov;
+	size_t size = 4096;
+	char *buf;
+	ssize_t ret;
+
+	buf = malloc(size);
+	memset(&msg, 0, sizeof(msg));
+	iov.iov_base = buf;
+	iov.iov_len = 1;
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = cmsg_buf;
+	msg.msg_controllen = sizeof(cmsg_buf);
+	if (recvmsg(sock, &msg, 0) != 1)
+		return NULL;
+	cmsg = CMSG_FIRSTHDR(&msg);
+	if (!cmsg || cmsg->cmsg_type != SCM_RIGHTS ||
+	    cmsg->cmsg_len != CMSG_LEN(2 * sizeof(int)))
+		return NULL;
+	memcpy(fds, CMSG_DATA(cmsg), 2 * sizeof(int));
+
+	*len = 1;
+	for (;;) {
+		if (*len == size) {
+			size *= 2;
+			buf = realloc(buf, size);
+		}
+		ret = read(sock, buf + *len, size - *len);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret < 0)
+			return NULL;
+		if (ret == 0)
+			break;
+		*len += ret;
+	}
+	if (buf[*len - 1] != '\0')
+		return NULL;
+	return buf;
+}
+
+static void run_request(char *progname, char *buf, size_t len, int fds[2])
+{
+	char **argv;
+	char *p;
+	int argc = 0;
+	int max = 16;
+	const char *mismatch;
+
+	argv = malloc(max * sizeof(*argv));
+	argv[argc++] = progname;
+	p = buf + strlen(buf) + 1;
+	while (p < buf + len) {
+		if (argc + 1 >= max) {
+			max *= 2;
+			argv = realloc(argv, max * sizeof(*argv));
+		}
+		argv[argc++] = p;
+		p += strlen(p) + 1;
+	}
+	argv[argc] = NULL;
+
+	dup2(fds[0], 1);
+	dup2(fds[1], 2);
+	close(fds[0]);
+	close(fds[1]);
+
+	if (chdir(buf)) {
+		fprintf(stderr, "smatch: cannot chdir to %s\n", buf);
+		exit(1);
+	}
+
+	mismatch = parse_client_args(&argc, &argv);
+	if (mismatch) {
+		fprintf(stderr, "smatch: %s doesn't match what the server was started with\n",
+			mismatch);
+		exit(1);
+	}
+
+	smatch(argc, argv);
+	fflush(sm_outfd);
+	exit(0);
+}
+
+static void handle_client(int sock, char *progname)
+{
+	unsigned char status = 1;
+	size_t len;
+	char *buf;
+	int fds[2];
+	int ret;
+	pid_t pid;
+
+	buf = read_request(sock, fds, &len);
+	if (!buf)
+		exit(1);
+
+	pid = fork();
+	if (pid < 0)
+		exit(1);
+	if (pid == 0) {
+		close(sock);
+		run_request(progname, buf, len, fds);
+	}
+	close(fds[0]);
+	close(fds[1]);
+
+	while (waitpid(pid, &ret, 0) < 0) {
+		if (errno != EINTR)
+			exit(1);
+	}
+	if (WIFEXITED(ret))
+		status = WEXITSTATUS(ret);
+	write_all(sock, (char *)&status, 1);
+	exit(0);
+}
+
+int smatch_server(const char *path, char *progname)
+{
+	struct sockaddr_un addr;
+	struct stat st;
+	int sock, client;
+	mode_t old_mask;
+	int ret;
+	pid_t pid;
+
+	if (fill_addr(&addr, path))
+		return 1;
+	if (stat(path, &st) == 0 && S_ISSOCK(st.st_mode))
+		unlink(path);
+
+	sock = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (sock < 0) {
+		fprintf(stderr, "smatch: cannot create a socket: %s\n", strerror(errno));
+		return 1;
+	}
+	/* bind() creates the file so a chmod() afterwards would be too late */
+	old_mask = umask(077);
+	ret = bind(sock, (struct sockaddr *)&addr, sizeof(addr));
+	umask(old_mask);
+	if (ret || listen(sock, 64)) {
+		fprintf(stderr, "smatch: cannot listen on %s: %s\n", path, strerror(errno));
+		return 1;
+	}
+	signal(SIGPIPE, SIG_IGN);
+	fflush(stdout);
+	fflush(stderr);
+
+	for (;;) {
+		client = accept(sock, NULL, NULL);
+		while (waitpid(-1, NULL, WNOHANG) > 0)
+			;
+		if (client < 0) {
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+			fprintf(stderr, "smatch: accept: %s\n", strerror(errno));
+			return 1;
+		}
+
+		pid = fork();
+		if (pid == 0) {
+			close(sock);
+			signal(SIGPIPE, SIG_DFL);
+			handle_client(client, progname);
+		}
+		close(client);
+	}
+	return 0;
+}
@@ -17,20 +17,34 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include "bitmap.h"
 #include "smatch.h"
 #include "smatch_slist.h"
+#include "smatch_extra.h"
 
 #undef CHECKORDER
 
-ALLOCATOR(smatch_state, "smatch state");
-ALLOCATOR(sm_state, "sm state");
-ALLOCATOR(named_stree, "named slist");
-__DO_ALLOCATOR(char, 1, 4, "state names", sname);
+struct arena function_arena = { .name = "function arena" };
 
-static int sm_state_counter;
+static void free_sm_state(void *entry);
+static struct smatch_state *merge_states(int owner, const char *name,
+					 struct symbol *sym,
+					 struct smatch_state *state1,
+					 struct smatch_state *state2);
+
+ARENA_ALLOCATOR(smatch_state, "smatch state", &function_arena, NULL);
+ARENA_ALLOCATOR(sm_state, "sm state", &function_arena, &free_sm_state);
+ALLOCATOR(named_stree, "named slist");
+__DO_ARENA_ALLOCATOR(char, 1, 4, "state names", sname, &function_arena, NULL);
 
 static struct stree_stack *all_pools;
 
+/*
+ * Bumped whenever an existing sm_state gets a new ->pool or new history so
+ * anything cached about the pools knows it is stale.
+ */
+unsigned long __pool_generation;
+
 char *show_sm(struct sm_state *sm)
 {
 	static char buf[256];
@@ -98,11 +112,13 @@ int cmp_tracker(const struct sm_state *a, const struct sm_state *b)
 	if (a->owner < b->owner)
 		return 1;
 
-	ret = strcmp(a->name, b->name);
-	if (ret < 0)
-		return -1;
-	if (ret > 0)
-		return 1;
+	if (a->name != b->name) {
+		ret = strcmp(a->name, b->name);
+		if (ret < 0)
+			return -1;
+		if (ret > 0)
+			return 1;
+	}
 
 	if (!b->sym && a->sym)
 		return -1;
@@ -150,14 +166,185 @@ static int cmp_sm_states(const struct sm_state *a, const struct sm_state *b, int
 	return 0;
 }
 
+/*
+ * The sm_state names are interned so that two states for the same
+ * variable share the name pointer.  cmp_tracker() only has to do a
+ * strcmp() when the names are different.  The table is cleared at the end
+ * of the function along with the snames.
+ */
+static const char **snames;
+static int snames_size;
+static int snames_used;
+
+static unsigned int sname_hash(const char *str)
+{
+	unsigned int hash = 5381;
+
+	while (*str)
+		hash = hash * 33 + (unsigned char)*str++;
+	return hash;
+}
+
+static void grow_snames(void)
+{
+	const char **old = snames;
+	int old_size = snames_size;
+	unsigned int h;
+	int i;
+
+	snames_size = old_size ? old_size * 2 : 1024;
+	snames = calloc(snames_size, sizeof(*snames));
+	for (i = 0; i < old_size; i++) {
+		if (!old[i])
+			continue;
+		h = sname_hash(old[i]) & (snames_size - 1);
+		while (snames[h])
+			h = (h + 1) & (snames_size - 1);
+		snames[h] = old[i];
+	}
+	free(old);
+}
+
+static int find_sname(const char *str)
+{
+	unsigned int h;
+
+	h = sname_hash(str) & (snames_size - 1);
+	while (snames[h] && strcmp(snames[h], str) != 0)
+		h = (h + 1) & (snames_size - 1);
+	return h;
+}
+
+static const char *intern_sname(const char *str)
+{
+	int h;
+
+	if (!str)
+		return NULL;
+	if (snames_used * 2 >= snames_size)
+		grow_snames();
+	h = find_sname(str);
+	if (!snames[h]) {
+		snames[h] = alloc_sname(str);
+		snames_used++;
+	}
+	return snames[h];
+}
+
+static void clear_snames(void)
+{
+	if (!snames_used)
+		return;
+	memset(snames, 0, snames_size * sizeof(*snames));
+	snames_used = 0;
+}
+
+/*
+ * The modification hooks only care about the owners which have states for
+ * the modified sym.  Every sm_state is allocated here and they are all
+ * freed together at the end of the function, so this is where we record
+ * which owners have states for each sym.
+ */
+struct sym_owners {
+	struct symbol *sym;
+	unsigned long *owners;
+};
+static struct sym_owners *sym_owners;
+static unsigned long *owner_bits;
+static int sym_owners_size;
+static int sym_owners_used;
+static int owner_words;
+
+static unsigned int sym_hash(struct symbol *sym)
+{
+	unsigned long x = (unsigned long)sym;
+
+	return (x >> 4) ^ (x >> 12);
+}
+
+static void grow_sym_owners(void)
+{
+	struct sym_owners *old = sym_owners;
+	unsigned long *old_bits = owner_bits;
+	int old_size = sym_owners_size;
+	unsigned int h;
+	int i;
+
+	if (!owner_words)
+		owner_words = num_checks / (sizeof(unsigned long) * 8) + 1;
+
+	sym_owners_size = old_size ? old_size * 2 : 256;
+	sym_owners = calloc(sym_owners_size, sizeof(*sym_owners));
+	owner_bits = calloc(sym_owners_size * owner_words, sizeof(unsigned long));
+
+	for (i = 0; i < old_size; i++) {
+		if (!old[i].owners)
+			continue;
+		h = sym_hash(old[i].sym) & (sym_owners_size - 1);
+		while (sym_owners[h].owners)
+			h = (h + 1) & (sym_owners_size - 1);
+		sym_owners[h].sym = old[i].sym;
+		sym_owners[h].owners = owner_bits + h * owner_words;
+		memcpy(sym_owners[h].owners, old[i].owners,
+		       owner_words * sizeof(unsigned long));
+	}
+	free(old);
+	free(old_bits);
+}
+
+static void record_sym_owner(struct symbol *sym, int owner)
+{
+	unsigned int h;
+
+	if (owner < 0 || owner > num_checks)
+		return;
+	if (sym_owners_used * 2 >= sym_owners_size)
+		grow_sym_owners();
+
+	h = sym_hash(sym) & (sym_owners_size - 1);
+	while (sym_owners[h].owners && sym_owners[h].sym != sym)
+		h = (h + 1) & (sym_owners_size - 1);
+	if (!sym_owners[h].owners) {
+		sym_owners[h].sym = sym;
+		sym_owners[h].owners = owner_bits + h * owner_words;
+		sym_owners_used++;
+	}
+	set_bit(owner, sym_owners[h].owners);
+}
+
+/* a bitmap of the owners which have states for sym or NULL if none do */
+unsigned long *get_sym_owners(struct symbol *sym)
+{
+	unsigned int h;
+
+	if (!sym_owners_used)
+		return NULL;
+	h = sym_hash(sym) & (sym_owners_size - 1);
+	while (sym_owners[h].owners) {
+		if (sym_owners[h].sym == sym)
+			return sym_owners[h].owners;
+		h = (h + 1) & (sym_owners_size - 1);
+	}
+	return NULL;
+}
+
+static void clear_sym_owners(void)
+{
+	if (!sym_owners_used)
+		return;
+	memset(sym_owners, 0, sym_owners_size * sizeof(*sym_owners));
+	memset(owner_bits, 0, sym_owners_size * owner_words * sizeof(unsigned long));
+	sym_owners_used = 0;
+}
+
 struct sm_state *alloc_sm_state(int owner, const char *name,
 				struct symbol *sym, struct smatch_state *state)
 {
 	struct sm_state *sm_state = __alloc_sm_state(0);
 
-	sm_state_counter++;
+	record_sym_owner(sym, owner);
 
-	sm_state->name = alloc_sname(name);
+	sm_state->name = intern_sname(name);
 	sm_state->owner = owner;
 	sm_state->sym = sym;
 	sm_state->state = state;
@@ -183,13 +370,190 @@ static struct sm_state *alloc_state_no_name(int owner, const char *name,
 	return tmp;
 }
 
+/*
+ * The memory budget is per function.  It counts everything that the
+ * allocators have handed out since the function started, not just the
+ * sm_states.  As a function gets close to the budget we give up on the
+ * expensive stuff a bit at a time so that the function can still be
+ * checked:
+ *
+ * 1) Past half the budget, stop saving implication pools when paths merge.
+ * 2) Past three quarters, stop adding to the ->possible lists.
+ * 3) Past the whole budget, give up on the rest of the function.
+ *
+ * The test suite uses __smatch_mem_budget_used() to get to each stage
+ * because the real numbers depend on the size of everything.
+ */
+static unsigned long fn_start_bytes;
+static unsigned long fn_fake_bytes;
+
+void __start_mem_budget(void)
+{
+	fn_start_bytes = allocated_bytes;
+	fn_fake_bytes = 0;
+}
+
+static unsigned long mem_budget(void)
+{
+	return (unsigned long)option_mem_budget * 1024 * 1024;
+}
+
+void __use_mem_budget(int percent)
+{
+	fn_fake_bytes = mem_budget() / 100 * percent;
+}
+
+static unsigned long fn_bytes_used(void)
+{
+	if (allocated_bytes < fn_start_bytes)
+		return fn_fake_bytes;
+	return allocated_bytes - fn_start_bytes + fn_fake_bytes;
+}
+
+int out_of_memory(void)
+{
+	if (fn_bytes_used() >= mem_budget())
+		return 1;
+	return 0;
+}
+
+int low_on_memory(void)
+{
+	if (fn_bytes_used() >= mem_budget() / 2)
+		return 1;
+	return 0;
+}
+
+static int collapse_possible(void)
+{
+	if (fn_bytes_used() >= mem_budget() / 4 * 3)
+		return 1;
+	return 0;
+}
+
 int too_many_possible(struct sm_state *sm)
 {
+	/* add_possible_sm() gave up so the list isn't complete */
+	if (sm->nr_children > 4000)
+		return 1;
 	if (ptr_list_size((struct ptr_list *)sm->possible) >= 100)
 		return 1;
 	return 0;
 }
 
+/*
+ * After 100 possible states we stop keeping the unmerged SMATCH_EXTRA
+ * states.  After option_max_possible we stop adding new states at all.
+ * Merged states are dropped first because the leaves already say the same
+ * thing.  After that a new leaf which an existing leaf already covers is
+ * dropped and anything else is merged into one leaf using the owner's merge
+ * function so the list still covers everything that is possible, just less
+ * precisely.  For SMATCH_EXTRA that's the leaf with the closest range.  The
+ * list is sorted by pointer so the choice can't depend on the order.
+ */
+static unsigned long *widen_counts;
+
+static int at_possible_cap(struct sm_state *sm)
+{
+	if (!option_max_possible)
+		return 0;
+	if (ptr_list_size((struct ptr_list *)sm->possible) >= option_max_possible)
+		return 1;
+	return 0;
+}
+
+static int leaf_covers(struct sm_state *to, struct sm_state *leaf, struct sm_state *new)
+{
+	struct range_list *rl;
+
+	if (leaf->state == new->state)
+		return 1;
+	if (to->owner != SMATCH_EXTRA)
+		return 0;
+	rl = estate_rl(leaf->state);
+	return rl_equiv(rl_union(rl, estate_rl(new->state)), rl);
+}
+
+static unsigned long long rl_gap(struct range_list *one, struct range_list *two)
+{
+	if (sval_cmp(rl_max(one), rl_min(two)) < 0)
+		return rl_min(two).uvalue - rl_max(one).uvalue;
+	if (sval_cmp(rl_max(two), rl_min(one)) < 0)
+		return rl_min(one).uvalue - rl_max(two).uvalue;
+	return 0;
+}
+
+static int better_target(struct sm_state *to, struct sm_state *new,
+			 struct sm_state *one, struct sm_state *two)
+{
+	struct range_list *new_rl, *rl_one, *rl_two;
+	unsigned long long gap_one, gap_two;
+	const char *name_one, *name_two;
+
+	if (!two)
+		return 1;
+
+	if (to->owner == SMATCH_EXTRA) {
+		new_rl = estate_rl(new->state);
+		rl_one = estate_rl(one->state);
+		rl_two = estate_rl(two->state);
+		gap_one = rl_gap(rl_one, new_rl);
+		gap_two = rl_gap(rl_two, new_rl);
+		if (gap_one != gap_two)
+			return gap_one < gap_two;
+		return sval_cmp(rl_min(rl_one), rl_min(rl_two)) < 0;
+	}
+
+	/* not ->name, lazy states all have the same place holder name */
+	name_one = show_state(one->state);
+	name_two = show_state(two->state);
+	if (!name_one || !name_two)
+		return !!name_one;
+	return strcmp(name_one, name_two) < 0;
+}
+
+static void widen_possible(struct sm_state *to, struct sm_state *new)
+{
+	struct sm_state *tmp, *target = NULL, *summary;
+	struct smatch_state *state;
+
+	if (new->merged)
+		return;
+	FOR_EACH_PTR(to->possible, tmp) {
+		if (tmp->merged) {
+			DELETE_CURRENT_PTR(tmp);
+			PACK_PTR_LIST(&to->possible);
+			add_possible_sm(to, new);
+			return;
+		}
+	} END_FOR_EACH_PTR(tmp);
+
+	FOR_EACH_PTR(to->possible, tmp) {
+		if (leaf_covers(to, tmp, new))
+			return;
+		if (better_target(to, new, tmp, target))
+			target = tmp;
+	} END_FOR_EACH_PTR(tmp);
+
+	if (!widen_counts)
+		widen_counts = calloc(num_checks + 1, sizeof(*widen_counts));
+	if (to->owner >= 0 && to->owner <= num_checks)
+		widen_counts[to->owner]++;
+
+	delete_ptr_list_entry((struct ptr_list **)&to->possible, target, 1);
+	state = merge_states(to->owner, to->name, to->sym, target->state, new->state);
+	summary = alloc_state_no_name(to->owner, to->name, to->sym, state);
+	summary->line = new->line;
+	add_possible_sm(to, summary);
+}
+
+unsigned long possible_widen_count(int owner)
+{
+	if (!widen_counts || owner < 0 || owner > num_checks)
+		return 0;
+	return widen_counts[owner];
+}
+
 void add_possible_sm(struct sm_state *to, struct sm_state *new)
 {
 	struct sm_state *tmp;
@@ -197,6 +561,14 @@ void add_possible_sm(struct sm_state *to, struct sm_state *new)
 
 	if (too_many_possible(to))
 		preserve = 0;
+	/*
+	 * An empty or partial ->possible list looks like there is less
+	 * history than there is so mark the sm as too complicated.
+	 */
+	if (collapse_possible()) {
+		to->nr_children = 4001;
+		return;
+	}
 
 	FOR_EACH_PTR(to->possible, tmp) {
 		if (cmp_sm_states(tmp, new, preserve) < 0)
@@ -204,10 +576,18 @@ void add_possible_sm(struct sm_state *to, struct sm_state *new)
 		else if (cmp_sm_states(tmp, new, preserve) == 0) {
 			return;
 		} else {
+			if (at_possible_cap(to)) {
+				widen_possible(to, new);
+				return;
+			}
 			INSERT_CURRENT(new, tmp);
 			return;
 		}
 	} END_FOR_EACH_PTR(tmp);
+	if (at_possible_cap(to)) {
+		widen_possible(to, new);
+		return;
+	}
 	add_ptr_list(&to->possible, new);
 }
 
@@ -231,27 +611,10 @@ char *alloc_sname(const char *str)
 	return tmp;
 }
 
-int out_of_memory(void)
-{
-	/*
-	 * I decided to use 50M here based on trial and error.
-	 * It works out OK for the kernel and so it should work
-	 * for most other projects as well.
-	 */
-	if (sm_state_counter * sizeof(struct sm_state) >= 50000000)
-		return 1;
-	return 0;
-}
-
-int low_on_memory(void)
+static void free_sm_state(void *entry)
 {
-	if (sm_state_counter * sizeof(struct sm_state) >= 25000000)
-		return 1;
-	return 0;
-}
+	struct sm_state *sm = entry;
 
-static void free_sm_state(struct sm_state *sm)
-{
 	free_slist(&sm->possible);
 	/*
 	 * fixme.  Free the actual state.
@@ -261,39 +624,17 @@ static void free_sm_state(struct sm_state *sm)
 	 */
 }
 
-static void free_all_sm_states(struct allocation_blob *blob)
-{
-	unsigned int size = sizeof(struct sm_state);
-	unsigned int offset = 0;
-
-	while (offset < blob->offset) {
-		free_sm_state((struct sm_state *)(blob->data + offset));
-		offset += size;
-	}
-}
-
-/* At the end of every function we free all the sm_states */
+/*
+ * At the end of every function we forget all the sm_states.  The memory
+ * goes back when split_function() releases the function_arena.
+ */
 void free_every_single_sm_state(void)
 {
-	struct allocator_struct *desc = &sm_state_allocator;
-	struct allocation_blob *blob = desc->blobs;
-
-	desc->blobs = NULL;
-	desc->allocations = 0;
-	desc->total_bytes = 0;
-	desc->useful_bytes = 0;
-	desc->freelist = NULL;
-	while (blob) {
-		struct allocation_blob *next = blob->next;
-		free_all_sm_states(blob);
-		blob_free(blob, desc->chunking);
-		blob = next;
-	}
-	clear_sname_alloc();
-	clear_smatch_state_alloc();
-
+	clear_sym_owners();
+	clear_snames();
+	stree_generation++;
+	__pool_generation++;
 	free_stack_and_strees(&all_pools);
-	sm_state_counter = 0;
 }
 
 struct sm_state *clone_sm(struct sm_state *s)
@@ -617,6 +958,9 @@ static void match_states_stree(struct stree **one, struct stree **two)
 						  one_iter.sm->sym, tmp_state);
 			add_ptr_list(&add_to_two, sm);
 			avl_iter_next(&one_iter);
+		} else if (one_iter.node == two_iter.node) {
+			avl_iter_next_skip(&one_iter);
+			avl_iter_next_skip(&two_iter);
 		} else if (cmp_tracker(one_iter.sm, two_iter.sm) == 0) {
 			avl_iter_next(&one_iter);
 			avl_iter_next(&two_iter);
@@ -712,6 +1056,9 @@ static void __merge_stree(struct stree **to, struct stree *stree, int add_pool)
 		return;
 	}
 
+	if (add_pool && low_on_memory())
+		add_pool = 0;
+
 	implied_one = clone_stree(*to);
 	implied_two = clone_stree(stree);
 
@@ -730,8 +1077,18 @@ static void __merge_stree(struct stree **to, struct stree *stree, int add_pool)
 			set_stree_id(&implied_two->base_stree, ++__stree_id);
 	}
 
-	push_stree(&all_pools, implied_one);
-	push_stree(&all_pools, implied_two);
+	if (add_pool) {
+		push_stree(&all_pools, implied_one);
+		push_stree(&all_pools, implied_two);
+	}
+
+	/*
+	 * Merging a state with itself gives back the same state so start
+	 * with a copy of implied_one and only replace the ones that differ.
+	 * If both sides share a node then they share the whole subtree under
+	 * it as well so we can skip over it.
+	 */
+	results = copy_stree(implied_one);
 
 	avl_iter_begin(&one_iter, implied_one, FORWARD);
 	avl_iter_begin(&two_iter, implied_two, FORWARD);
@@ -741,9 +1098,18 @@ static void __merge_stree(struct stree **to, struct stree *stree, int add_pool)
 			break;
 		if (cmp_tracker(one_iter.sm, two_iter.sm) < 0) {
 			sm_msg("error:  Internal smatch error.");
+			avl_remove(&results, one_iter.sm);
+			avl_iter_next(&one_iter);
+		} else if (one_iter.node == two_iter.node) {
+			avl_iter_next_skip(&one_iter);
+			avl_iter_next_skip(&two_iter);
+		} else if (one_iter.sm == two_iter.sm) {
+			add_possible_sm(one_iter.sm, one_iter.sm);
 			avl_iter_next(&one_iter);
+			avl_iter_next(&two_iter);
 		} else if (cmp_tracker(one_iter.sm, two_iter.sm) == 0) {
-			if (add_pool && one_iter.sm != two_iter.sm) {
+			if (add_pool) {
+				__pool_generation++;
 				one_iter.sm->pool = implied_one;
 				if (implied_one->base_stree)
 					one_iter.sm->pool = implied_one->base_stree;
@@ -754,6 +1120,12 @@ static void __merge_stree(struct stree **to, struct stree *stree, int add_pool)
 			tmp_sm = merge_sm_states(one_iter.sm, two_iter.sm);
 			add_possible_sm(tmp_sm, one_iter.sm);
 			add_possible_sm(tmp_sm, two_iter.sm);
+			/*
+			 * A merged state adds itself to its ->possible list the
+			 * first time it is merged with itself.  Do it now so
+			 * that shared subtrees can be skipped later.
+			 */
+			add_possible_sm(tmp_sm, tmp_sm);
 			avl_insert(&results, tmp_sm);
 			avl_iter_next(&one_iter);
 			avl_iter_next(&two_iter);
@@ -763,6 +1135,11 @@ static void __merge_stree(struct stree **to, struct stree *stree, int add_pool)
 		}
 	}
 
+	if (!add_pool) {
+		free_stree(&implied_one);
+		free_stree(&implied_two);
+	}
+
 	free_stree(to);
 	*to = results;
 }
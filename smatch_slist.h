@@ -11,8 +11,10 @@ DECLARE_ALLOCATOR(named_stree);
 DECLARE_PTR_LIST(named_stree_stack, struct named_stree);
 
 
+extern struct arena function_arena;
 extern struct state_list_stack *implied_pools;
 extern int __stree_id;
+extern unsigned long __pool_generation;
 
 char *show_sm(struct sm_state *sm);
 void __print_stree(struct stree *stree);
@@ -23,6 +25,7 @@ struct sm_state *alloc_sm_state(int owner, const char *name,
 				struct symbol *sym, struct smatch_state *state);
 
 void free_every_single_sm_state(void);
+unsigned long *get_sym_owners(struct symbol *sym);
 struct sm_state *clone_sm(struct sm_state *s);
 int is_merged(struct sm_state *sm);
 int is_leaf(struct sm_state *sm);
@@ -31,6 +34,7 @@ struct state_list *clone_slist(struct state_list *from_slist);
 int slist_has_state(struct state_list *slist, struct smatch_state *state);
 
 int too_many_possible(struct sm_state *sm);
+unsigned long possible_widen_count(int owner);
 void add_possible_sm(struct sm_state *to, struct sm_state *new);
 struct sm_state *merge_sm_states(struct sm_state *one, struct sm_state *two);
 struct smatch_state *get_state_stree(struct stree *stree, int owner, const char *name,
@@ -70,6 +74,8 @@ struct smatch_state *get_state_stree_stack(struct stree_stack *stack, int owner,
 
 int out_of_memory(void);
 int low_on_memory(void);
+void __start_mem_budget(void);
+void __use_mem_budget(int percent);
 void merge_stree(struct stree **to, struct stree *stree);
 void merge_stree_no_pools(struct stree **to, struct stree *stree);
 void merge_stree(struct stree **to, struct stree *right);
@@ -106,9 +106,9 @@ static void add_fake_type_val(char *member, struct range_list *rl, int ignore)
 
 	member = alloc_string(member);
 	old = get_state_stree(fn_type_val, my_id, member, NULL);
-	if (old && strcmp(old->name, "min-max") == 0)
+	if (old && strcmp(show_state(old), "min-max") == 0)
 		return;
-	if (ignore && old && strcmp(old->name, "ignore") == 0)
+	if (ignore && old && strcmp(show_state(old), "ignore") == 0)
 		return;
 	add = alloc_estate_rl(rl);
 	if (old) {
@@ -394,7 +394,7 @@ static void match_end_func_info(struct symbol *sym)
 	struct sm_state *sm;
 
 	FOR_EACH_SM(fn_type_val, sm) {
-		sql_insert_function_type_value(sm->name, sm->state->name);
+		sql_insert_function_type_value(sm->name, show_state(sm->state));
 	} END_FOR_EACH_SM(sm);
 }
 
@@ -408,7 +408,7 @@ static void match_end_file(struct symbol_list *sym_list)
 	struct sm_state *sm;
 
 	FOR_EACH_SM(global_type_val, sm) {
-		sql_insert_function_type_value(sm->name, sm->state->name);
+		sql_insert_function_type_value(sm->name, show_state(sm->state));
 	} END_FOR_EACH_SM(sm);
 }
 
@@ -30,20 +30,68 @@
 #include <ctype.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/time.h>
 
 #include "token.h"
 #include "symbol.h"
+#include "allocate.h"
+
+#define BENCH_LOOPS 20
+
+/*
+ * test-lexing --bench file.c...
+ *
+ * Tokenize each file over and over without preprocessing it and print how
+ * fast the tokenizer went.
+ */
+static int benchmark(int argc, char **argv)
+{
+	struct timeval start, stop;
+	struct stat st;
+	double secs;
+	int i, loop, fd;
+
+	for (i = 0; i < argc; i++) {
+		fd = open(argv[i], O_RDONLY);
+		if (fd < 0 || fstat(fd, &st)) {
+			fprintf(stderr, "cannot open %s\n", argv[i]);
+			return 1;
+		}
+		close(fd);
+
+		gettimeofday(&start, NULL);
+		for (loop = 0; loop < BENCH_LOOPS; loop++) {
+			fd = open(argv[i], O_RDONLY);
+			tokenize(argv[i], fd, NULL, NULL);
+			close(fd);
+			clear_token_alloc();
+		}
+		gettimeofday(&stop, NULL);
+
+		secs = (stop.tv_sec - start.tv_sec) +
+		       (stop.tv_usec - start.tv_usec) / 1000000.0;
+		printf("%s: %lld bytes %d times in %.3f s: %.1f MB/s\n",
+		       argv[i], (long long)st.st_size, BENCH_LOOPS, secs,
+		       secs ? st.st_size * BENCH_LOOPS / secs / (1024 * 1024) : 0.0);
+	}
+	return 0;
+}
 
 int main(int argc, char **argv)
 {
 	struct string_list *filelist = NULL;
 	char *file;
 
+	if (argc > 1 && !strcmp(argv[1], "--bench"))
+		return benchmark(argc - 2, argv + 2);
+
 	preprocess_only = 1;
 	sparse_initialize(argc, argv, &filelist);
 	FOR_EACH_PTR_NOTAG(filelist, file) {
 		sparse(file);
 	} END_FOR_EACH_PTR_NOTAG(file);
 	show_identifier_stats();
+	show_token_cache_stats();
 	return 0;
 }
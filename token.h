@@ -69,7 +69,6 @@ extern int no_lineno;
 extern int *hash_stream(const char *name);
 
 struct ident {
-	struct ident *next;	/* Hash chain of identifiers */
 	struct symbol *symbols;	/* Pointer to semantic meaning list */
 	unsigned char len;	/* Length of identifier name */
 	unsigned char tainted:1,
@@ -228,10 +227,13 @@ extern struct token * tokenize(const char *, int, struct token *, const char **n
 extern struct token * tokenize_buffer(void *, unsigned long, struct token **);
 
 extern void show_identifier_stats(void);
+extern void show_token_cache_stats(void);
+extern const char *token_cache_dir;
 extern void init_include_path(void);
 extern struct token *preprocess(struct token *);
 
 extern void store_all_tokens(struct token *token);
+extern void show_token_store_stats(void);
 extern struct token *pos_get_token(struct position pos);
 extern char *pos_ident(struct position pos);
 
@@ -27,125 +27,108 @@
 #include <string.h>
 #include "lib.h"
 #include "parse.h"
-#include "allocate.h"
 
-struct line {
+/*
+ * The preprocessor frees the tokens on the # lines and changes the macro
+ * bodies so we have to save the tokens of the main file before it runs.
+ * Most of the time nothing looks at them though, so just save the
+ * position and the value of each token.  The first time someone asks for
+ * a line they are turned into real tokens along with a line index.  The
+ * tokenizer hands them to us in order so both are sorted by line.
+ */
+struct stored_token {
 	struct position pos;
-	struct line *prev;
-	struct token *token;
-	struct line *next;
+	const char *value;	/* the whole token union */
 };
 
-__ALLOCATOR(struct token, "token store", perm_token);
-ALLOCATOR(line, "line of tokens");
-
-static struct token *copy_token(struct token *token)
-{
-	struct token *new;
-
-	new = __alloc_perm_token(0);
-	memcpy(new, token, sizeof(*token));
-	new->next = NULL;
-	return new;
-}
-
-static struct line *cursor;
-
-static void find_line(struct position pos)
-{
-	if (!cursor)
-		return;
-	if (pos.line == cursor->pos.line)
-		return;
-	if (pos.line < cursor->pos.line) {
-		if (!cursor->prev)
-			return;
-		cursor = cursor->prev;
-		find_line(pos);
-		return;
-	}
-	if (!cursor->next)
-		return;
-	if (pos.line < cursor->next->pos.line)
-		return;
-	cursor = cursor->next;
-	find_line(pos);
-}
+static struct stored_token *stored;
+static struct token *tokens;
+static unsigned int *line_start;
+static int nr_stored;
+static unsigned int stored_stream;
+static unsigned int max_line;
+static unsigned long stored_bytes;
 
-static void insert_into_line(struct token **current, struct token *new)
+static void clear_token_store(void)
 {
-	if (!*current) {
-		*current = new;
-		return;
-	}
-
-	if (new->pos.pos < (*current)->pos.pos) {
-		new->next = *current;
-		*current = new;
-		return;
-	}
-
-	if (new->pos.pos == (*current)->pos.pos)
-		return;
-
-	insert_into_line(&(*current)->next, new);
+	free(stored);
+	free(tokens);
+	free(line_start);
+	stored = NULL;
+	tokens = NULL;
+	line_start = NULL;
+	nr_stored = 0;
+	stored_bytes = 0;
+	max_line = 0;
 }
 
-static void store_token(struct token *token)
+void store_all_tokens(struct token *token)
 {
-	token = copy_token(token);
+	struct token *tmp;
+	int i = 0;
 
-	find_line(token->pos);
+	/* only the file we are checking now is interesting */
+	clear_token_store();
+	stored_stream = token->pos.stream;
 
-	if (!cursor) {
-		cursor = __alloc_line(0);
-		cursor->pos = token->pos;
-		cursor->token = token;
+	for (tmp = token; token_type(tmp) != TOKEN_STREAMEND; tmp = tmp->next)
+		nr_stored++;
+	if (!nr_stored)
 		return;
-	}
-
-	if (token->pos.line < cursor->pos.line) {
-		cursor->prev = __alloc_line(0);
-		cursor->prev->next = cursor;
-		cursor = cursor->prev;
-		cursor->pos = token->pos;
-		cursor->token = token;
-		return;
-	}
 
-	if (token->pos.line == cursor->pos.line) {
-		insert_into_line(&cursor->token, token);
-		return;
+	stored = malloc(nr_stored * sizeof(*stored));
+	if (!stored)
+		die("out of memory");
+	for (tmp = token; token_type(tmp) != TOKEN_STREAMEND; tmp = tmp->next) {
+		stored[i].pos = tmp->pos;
+		memcpy(&stored[i].value, &tmp->number, sizeof(stored[i].value));
+		if (tmp->pos.line > max_line)
+			max_line = tmp->pos.line;
+		i++;
 	}
-
-	cursor->next = __alloc_line(0);
-	cursor->next->prev = cursor;
-	cursor = cursor->next;
-	cursor->pos = token->pos;
-	cursor->token = token;
+	stored_bytes = nr_stored * sizeof(*stored);
 }
 
-void store_all_tokens(struct token *token)
+static void build_token_index(void)
 {
-	while (token_type(token) != TOKEN_STREAMEND) {
-		store_token(token);
-		token = token->next;
+	unsigned int line = 0;
+	int i;
+
+	tokens = malloc(nr_stored * sizeof(*tokens));
+	line_start = malloc((max_line + 2) * sizeof(*line_start));
+	if (!tokens || !line_start)
+		die("out of memory");
+
+	for (i = 0; i < nr_stored; i++) {
+		tokens[i].pos = stored[i].pos;
+		memcpy(&tokens[i].number, &stored[i].value, sizeof(stored[i].value));
+		tokens[i].next = NULL;
+		if (i && tokens[i - 1].pos.line == tokens[i].pos.line)
+			tokens[i - 1].next = &tokens[i];
+		while (line <= tokens[i].pos.line)
+			line_start[line++] = i;
 	}
+	while (line <= max_line + 1)
+		line_start[line++] = nr_stored;
+
+	free(stored);
+	stored = NULL;
+	stored_bytes = nr_stored * sizeof(*tokens) + (max_line + 2) * sizeof(*line_start);
 }
 
 struct token *first_token_from_line(struct position pos)
 {
-	find_line(pos);
-
-	if (!cursor)
+	if (!nr_stored)
 		return NULL;
-
-	if (cursor->pos.stream != pos.stream)
+	if (pos.stream != stored_stream || pos.line > max_line)
 		return NULL;
-	if (cursor->pos.line != pos.line)
+
+	if (!tokens)
+		build_token_index();
+	if (line_start[pos.line] == line_start[pos.line + 1])
 		return NULL;
 
-	return cursor->token;
+	return &tokens[line_start[pos.line]];
 }
 
 struct token *pos_get_token(struct position pos)
@@ -175,3 +158,9 @@ char *pos_ident(struct position pos)
 	return token->ident->name;
 }
 
+void show_token_store_stats(void)
+{
+	fprintf(stderr, "token store: %d tokens in %u lines, %lu bytes%s\n",
+		nr_stored, max_line, stored_bytes,
+		tokens ? " (indexed)" : "");
+}
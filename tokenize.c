@@ -31,6 +31,9 @@
 #include <ctype.h>
 #include <unistd.h>
 #include <stdint.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <sys/stat.h>
 
 #include "lib.h"
 #include "allocate.h"
@@ -422,7 +425,8 @@ got_eof:
 /*
  *  We want that as light as possible while covering all normal cases.
  *  Slow path (including the logics with line-splicing and EOF sanity
- *  checks) is in nextchar_slow().
+ *  checks) is in nextchar_slow().  Tabs and plain newlines are common
+ *  enough that they are done here as well.
  */
 static inline int nextchar(stream_t *stream)
 {
@@ -431,17 +435,86 @@ static inline int nextchar(stream_t *stream)
 	if (offset < stream->size) {
 		int c = stream->buffer[offset++];
 		static const char special[256] = {
-			['\t'] = 1, ['\r'] = 1, ['\n'] = 1, ['\\'] = 1
+			['\t'] = 1, ['\n'] = 2, ['\r'] = 3, ['\\'] = 3
 		};
-		if (!special[c]) {
-			stream->offset = offset;
+		switch (special[c]) {
+		case 0:
 			stream->pos++;
-			return c;
+			break;
+		case 1:
+			stream->pos += tabstop - stream->pos % tabstop;
+			break;
+		case 2:
+			stream->line++;
+			stream->pos = 0;
+			stream->newline = 1;
+			break;
+		default:
+			return nextchar_slow(stream);
 		}
+		stream->offset = offset;
+		return c;
 	}
 	return nextchar_slow(stream);
 }
 
+/*
+ * Comments are skipped straight out of the buffer.  Eight bytes at a time
+ * while there is nothing interesting in them, then a byte at a time.  We
+ * stop in front of a '*' (unless it's a // comment), in front of a newline
+ * for // comments, and in front of anything nextchar_slow() has to look at.
+ */
+#define ONE_BYTES (~0UL / 0xff)
+#define HIGH_BITS (ONE_BYTES * 0x80)
+
+static inline unsigned long has_byte(unsigned long word, unsigned char c)
+{
+	unsigned long x = word ^ (ONE_BYTES * c);
+
+	return (x - ONE_BYTES) & ~x & HIGH_BITS;
+}
+
+static void skip_comment_text(stream_t *stream, int eoln)
+{
+	const unsigned char *buffer = stream->buffer;
+	int offset = stream->offset;
+	int size = stream->size;
+	unsigned long word;
+	int c;
+
+	for (;;) {
+		while (offset + (int)sizeof(word) <= size) {
+			memcpy(&word, buffer + offset, sizeof(word));
+			if (has_byte(word, '*') | has_byte(word, '\n') |
+			    has_byte(word, '\t') | has_byte(word, '\r') |
+			    has_byte(word, '\\'))
+				break;
+			offset += sizeof(word);
+			stream->pos += sizeof(word);
+		}
+		if (offset >= size)
+			break;
+		c = buffer[offset];
+		if (c == '\r' || c == '\\')
+			break;
+		if (c == '*' && !eoln)
+			break;
+		if (c == '\n') {
+			if (eoln)
+				break;
+			stream->line++;
+			stream->pos = 0;
+			stream->newline = 1;
+		} else if (c == '\t') {
+			stream->pos += tabstop - stream->pos % tabstop;
+		} else {
+			stream->pos++;
+		}
+		offset++;
+	}
+	stream->offset = offset;
+}
+
 struct token eof_token_entry;
 
 static struct token *mark_eof(stream_t *stream)
@@ -662,6 +735,7 @@ static int drop_stream_eoln(stream_t *stream)
 {
 	drop_token(stream);
 	for (;;) {
+		skip_comment_text(stream, 1);
 		switch (nextchar(stream)) {
 		case EOF:
 			return EOF;
@@ -685,6 +759,8 @@ static int drop_stream_comment(stream_t *stream)
 			warning(stream_pos(stream), "End of file in the middle of a comment");
 			return curr;
 		}
+		if (curr != '*')
+			skip_comment_text(stream, 0);
 		next = nextchar(stream);
 		if (curr == '*' && next == '/')
 			break;
@@ -806,44 +882,60 @@ static int get_one_special(int c, stream_t *stream)
 	return next;
 }
 
-#define IDENT_HASH_BITS (13)
-#define IDENT_HASH_SIZE (1<<IDENT_HASH_BITS)
-#define IDENT_HASH_MASK (IDENT_HASH_SIZE-1)
+/*
+ * The identifiers live in an open addressing table which doubles when it
+ * gets half full.  Each slot keeps the full hash next to the pointer so a
+ * probe only has to look at the ident when the hashes match.  The hash is
+ * FNV-1a, built up a character at a time while the identifier is scanned.
+ */
+#define IDENT_HASH_BITS (12)
 
-#define ident_hash_init(c)		(c)
-#define ident_hash_add(oldhash,c)	((oldhash)*11 + (c))
-#define ident_hash_end(hash)		((((hash) >> IDENT_HASH_BITS) + (hash)) & IDENT_HASH_MASK)
+#define ident_hash_init(c)		((2166136261u ^ (c)) * 16777619u)
+#define ident_hash_add(oldhash,c)	(((oldhash) ^ (c)) * 16777619u)
+#define ident_hash_end(hash)		((uint32_t)(hash) ^ ((uint32_t)(hash) >> 15))
 
-static struct ident *hash_table[IDENT_HASH_SIZE];
+struct ident_slot {
+	uint32_t hash;
+	struct ident *ident;
+};
+
+static struct ident_slot *hash_table;
+static unsigned int hash_table_mask;
 static int ident_hit, ident_miss, idents;
+static int ident_probes, ident_resizes;
 
 void show_identifier_stats(void)
 {
-	int i;
+	unsigned int size = hash_table_mask + 1;
+	unsigned int i;
 	int distribution[100];
 
 	fprintf(stderr, "identifiers: %d hits, %d misses\n",
 		ident_hit, ident_miss);
+	if (!hash_table)
+		return;
+	fprintf(stderr, "ident hash: %d idents in %u slots, %.1f%% load, %d resizes, %.2f average probes\n",
+		idents, size, idents * 100.0 / size, ident_resizes,
+		ident_hit + ident_miss ? (double)ident_probes / (ident_hit + ident_miss) : 0.0);
 
 	for (i = 0; i < 100; i++)
 		distribution[i] = 0;
 
-	for (i = 0; i < IDENT_HASH_SIZE; i++) {
-		struct ident * ident = hash_table[i];
-		int count = 0;
+	/* how far each ident is from the slot it hashed to */
+	for (i = 0; i < size; i++) {
+		int dist;
 
-		while (ident) {
-			count++;
-			ident = ident->next;
-		}
-		if (count > 99)
-			count = 99;
-		distribution[count]++;
+		if (!hash_table[i].ident)
+			continue;
+		dist = (i - hash_table[i].hash) & hash_table_mask;
+		if (dist > 99)
+			dist = 99;
+		distribution[dist]++;
 	}
 
 	for (i = 0; i < 100; i++) {
 		if (distribution[i])
-			fprintf(stderr, "%2d: %d buckets\n", i, distribution[i]);
+			fprintf(stderr, "%2d: %d idents\n", i, distribution[i]);
 	}
 }
 
@@ -857,37 +949,87 @@ static struct ident *alloc_ident(const char *name, int len)
 	return ident;
 }
 
+static struct ident_slot *empty_slot(uint32_t hash)
+{
+	unsigned int i = hash & hash_table_mask;
+
+	while (hash_table[i].ident)
+		i = (i + 1) & hash_table_mask;
+	return &hash_table[i];
+}
+
+static void grow_hash_table(void)
+{
+	struct ident_slot *old = hash_table;
+	unsigned int old_size = old ? hash_table_mask + 1 : 0;
+	unsigned int size = old ? old_size * 2 : 1 << IDENT_HASH_BITS;
+	unsigned int i;
+
+	hash_table = calloc(size, sizeof(*hash_table));
+	if (!hash_table)
+		die("out of memory for the identifier hash");
+	hash_table_mask = size - 1;
+	for (i = 0; i < old_size; i++) {
+		if (old[i].ident)
+			*empty_slot(old[i].hash) = old[i];
+	}
+	free(old);
+	if (old_size)
+		ident_resizes++;
+}
+
+static void add_slot(struct ident *ident, uint32_t hash)
+{
+	struct ident_slot *slot;
+
+	if (!hash_table || (idents + 1) * 2 > hash_table_mask + 1)
+		grow_hash_table();
+	slot = empty_slot(hash);
+	slot->hash = hash;
+	slot->ident = ident;
+	idents++;
+}
+
 static struct ident * insert_hash(struct ident *ident, unsigned long hash)
 {
-	ident->next = hash_table[hash];
-	hash_table[hash] = ident;
+	add_slot(ident, hash);
 	ident_miss++;
 	return ident;
 }
 
 static struct ident *create_hashed_ident(const char *name, int len, unsigned long hash)
 {
+	struct ident_slot *slot;
 	struct ident *ident;
-	struct ident **p;
-
-	p = &hash_table[hash];
-	while ((ident = *p) != NULL) {
-		if (ident->len == (unsigned char) len) {
-			if (strncmp(name, ident->name, len) != 0)
-				goto next;
-
-			ident_hit++;
+	unsigned int i;
+
+	if (hash_table) {
+		i = hash & hash_table_mask;
+		while ((ident = hash_table[i].ident) != NULL) {
+			ident_probes++;
+			if (hash_table[i].hash == hash &&
+			    ident->len == (unsigned char) len &&
+			    memcmp(name, ident->name, len) == 0) {
+				ident_hit++;
+				return ident;
+			}
+			i = (i + 1) & hash_table_mask;
+		}
+		ident_probes++;
+		/* there is room so the empty slot we ended on is ours */
+		if ((idents + 1) * 2 <= hash_table_mask + 1) {
+			slot = &hash_table[i];
+			ident = alloc_ident(name, len);
+			slot->hash = hash;
+			slot->ident = ident;
+			idents++;
+			ident_miss++;
 			return ident;
 		}
-next:
-		//misses++;
-		p = &ident->next;
 	}
 	ident = alloc_ident(name, len);
-	*p = ident;
-	ident->next = NULL;
+	add_slot(ident, hash);
 	ident_miss++;
-	idents++;
 	return ident;
 }
 
@@ -1029,11 +1171,376 @@ struct token * tokenize_buffer(void *buffer, unsigned long size, struct token **
 	return begin;
 }
 
+/*
+ * -ftoken-cache=<dir> saves the tokens of every file we tokenize in <dir>
+ * and loads them from there the next time instead of lexing the file
+ * again.  This only covers the lexing.  The tokens still go through the
+ * preprocessor so the cache doesn't care what is defined.
+ *
+ * The cache file is picked by hashing the file name, the inode, the size,
+ * the mtime and ctime down to the nanosecond and a hash of what's in the
+ * file.  The time stamps alone aren't enough because a generated header
+ * can be written twice in the same tick.  The same things are stored in
+ * the cache file and checked when it is loaded.  Files which gave a
+ * warning while they were lexed are not saved so that the warning is
+ * printed every time.
+ */
+const char *token_cache_dir;
+static unsigned long token_cache_hits, token_cache_misses;
+
+#define TOKEN_CACHE_MAGIC "sptok02\n"
+
+struct token_cache_key {
+	unsigned long long size;
+	unsigned long long mtime;
+	unsigned long long mtime_nsec;
+	unsigned long long ctime;
+	unsigned long long ctime_nsec;
+	unsigned long long content;
+	unsigned long long ino;
+	unsigned long long dev;
+	unsigned int tabstop;
+	unsigned int no_lineno;
+	unsigned int name_len;
+};
+
+struct cache_buf {
+	unsigned char *data;
+	unsigned long len, alloc;
+};
+
+void show_token_cache_stats(void)
+{
+	unsigned long total = token_cache_hits + token_cache_misses;
+
+	if (!token_cache_dir)
+		return;
+	fprintf(stderr, "token cache: %lu hits %lu misses (%.1f%%)\n",
+		token_cache_hits, token_cache_misses,
+		total ? token_cache_hits * 100.0 / total : 0.0);
+}
+
+static unsigned long long hash_contents(const unsigned char *data, unsigned long size)
+{
+	unsigned long long hash = 0xcbf29ce484222325ULL;
+	unsigned long i;
+
+	for (i = 0; i < size; i++)
+		hash = (hash ^ data[i]) * 0x100000001b3ULL;
+	return hash;
+}
+
+static void fill_cache_key(struct token_cache_key *key, const char *name, struct stat *st,
+			   const unsigned char *data, unsigned long size)
+{
+	memset(key, 0, sizeof(*key));
+	key->size = st->st_size;
+	key->mtime = st->st_mtime;
+	key->mtime_nsec = st->st_mtim.tv_nsec;
+	key->ctime = st->st_ctime;
+	key->ctime_nsec = st->st_ctim.tv_nsec;
+	key->content = hash_contents(data, size);
+	key->ino = st->st_ino;
+	key->dev = st->st_dev;
+	key->tabstop = tabstop;
+	key->no_lineno = no_lineno;
+	key->name_len = strlen(name);
+}
+
+static char *token_cache_file(const char *name, struct token_cache_key *key)
+{
+	static char buf[PATH_MAX];
+	unsigned long long hash = 0xcbf29ce484222325ULL;
+	const unsigned char *p;
+	unsigned int i;
+
+	p = (const unsigned char *)name;
+	for (i = 0; i < key->name_len; i++)
+		hash = (hash ^ p[i]) * 0x100000001b3ULL;
+	p = (const unsigned char *)key;
+	for (i = 0; i < sizeof(*key); i++)
+		hash = (hash ^ p[i]) * 0x100000001b3ULL;
+
+	snprintf(buf, sizeof(buf), "%s/%016llx.tok", token_cache_dir, hash);
+	return buf;
+}
+
+static void cache_put(struct cache_buf *buf, const void *data, unsigned long len)
+{
+	if (buf->len + len > buf->alloc) {
+		buf->alloc = (buf->len + len) * 2;
+		buf->data = realloc(buf->data, buf->alloc);
+		if (!buf->data)
+			die("out of memory");
+	}
+	memcpy(buf->data + buf->len, data, len);
+	buf->len += len;
+}
+
+static int cache_get(const unsigned char **p, const unsigned char *end, void *data, unsigned long len)
+{
+	if (end - *p < len)
+		return 0;
+	memcpy(data, *p, len);
+	*p += len;
+	return 1;
+}
+
+struct cached_pos {
+	unsigned char type;
+	unsigned char flags;
+	unsigned short pos;
+	unsigned int line;
+};
+
+static int save_one_token(struct cache_buf *buf, struct token *token)
+{
+	struct cached_pos cpos;
+	unsigned int len;
+
+	cpos.type = token_type(token);
+	cpos.flags = token->pos.newline | token->pos.whitespace << 1 |
+		     token->pos.noexpand << 2;
+	cpos.pos = token->pos.pos;
+	cpos.line = token->pos.line;
+	cache_put(buf, &cpos, sizeof(cpos));
+
+	switch (token_type(token)) {
+	case TOKEN_STREAMBEGIN:
+	case TOKEN_STREAMEND:
+		break;
+	case TOKEN_IDENT:
+		cache_put(buf, &token->ident->len, 1);
+		cache_put(buf, token->ident->name, token->ident->len);
+		break;
+	case TOKEN_NUMBER:
+		len = strlen(token->number) + 1;
+		cache_put(buf, &len, sizeof(len));
+		cache_put(buf, token->number, len);
+		break;
+	case TOKEN_CHAR:
+	case TOKEN_WIDE_CHAR:
+	case TOKEN_STRING:
+	case TOKEN_WIDE_STRING:
+		len = token->string->length;
+		cache_put(buf, &len, sizeof(len));
+		cache_put(buf, token->string->data, len);
+		break;
+	case TOKEN_CHAR_EMBEDDED_0 ... TOKEN_CHAR_EMBEDDED_3:
+	case TOKEN_WIDE_CHAR_EMBEDDED_0 ... TOKEN_WIDE_CHAR_EMBEDDED_3:
+		cache_put(buf, token->embedded, 4);
+		break;
+	case TOKEN_SPECIAL:
+		cache_put(buf, &token->special, sizeof(token->special));
+		break;
+	default:
+		return 0;
+	}
+	return 1;
+}
+
+static void save_cached_tokens(const char *name, struct token_cache_key *key, struct token *begin)
+{
+	struct cache_buf buf = { NULL, 0, 0 };
+	struct token *token;
+	char tmp[PATH_MAX];
+	char *file;
+	int fd;
+
+	cache_put(&buf, TOKEN_CACHE_MAGIC, 8);
+	cache_put(&buf, key, sizeof(*key));
+	cache_put(&buf, name, key->name_len);
+
+	for (token = begin; ; token = token->next) {
+		if (!save_one_token(&buf, token))
+			goto out;
+		if (token_type(token) == TOKEN_STREAMEND)
+			break;
+	}
+
+	/* write it somewhere else and rename it so readers never see half */
+	file = token_cache_file(name, key);
+	snprintf(tmp, sizeof(tmp), "%s.%d", file, (int)getpid());
+	fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		goto out;
+	if (write(fd, buf.data, buf.len) != buf.len) {
+		close(fd);
+		unlink(tmp);
+		goto out;
+	}
+	close(fd);
+	if (rename(tmp, file))
+		unlink(tmp);
+out:
+	free(buf.data);
+}
+
+static struct token *load_one_token(const unsigned char **p, const unsigned char *end, int idx)
+{
+	struct cached_pos cpos;
+	struct token *token;
+	struct string *string;
+	unsigned char ident_len;
+	unsigned int len;
+	char *number;
+
+	if (!cache_get(p, end, &cpos, sizeof(cpos)))
+		return NULL;
+
+	token = __alloc_token(0);
+	token->pos.type = cpos.type;
+	token->pos.stream = idx;
+	token->pos.newline = cpos.flags & 1;
+	token->pos.whitespace = (cpos.flags >> 1) & 1;
+	token->pos.noexpand = (cpos.flags >> 2) & 1;
+	token->pos.pos = cpos.pos;
+	token->pos.line = cpos.line;
+
+	switch (cpos.type) {
+	case TOKEN_STREAMBEGIN:
+	case TOKEN_STREAMEND:
+		break;
+	case TOKEN_IDENT:
+		if (!cache_get(p, end, &ident_len, 1) || end - *p < ident_len)
+			return NULL;
+		token->ident = create_hashed_ident((const char *)*p, ident_len,
+						   hash_name((const char *)*p, ident_len));
+		*p += ident_len;
+		break;
+	case TOKEN_NUMBER:
+		if (!cache_get(p, end, &len, sizeof(len)) || !len || end - *p < len)
+			return NULL;
+		number = __alloc_bytes(len);
+		memcpy(number, *p, len);
+		number[len - 1] = '\0';
+		token->number = number;
+		*p += len;
+		break;
+	case TOKEN_CHAR:
+	case TOKEN_WIDE_CHAR:
+	case TOKEN_STRING:
+	case TOKEN_WIDE_STRING:
+		if (!cache_get(p, end, &len, sizeof(len)) || end - *p < len)
+			return NULL;
+		string = __alloc_string(len);
+		string->length = len;
+		memcpy(string->data, *p, len);
+		token->string = string;
+		*p += len;
+		break;
+	case TOKEN_CHAR_EMBEDDED_0 ... TOKEN_CHAR_EMBEDDED_3:
+	case TOKEN_WIDE_CHAR_EMBEDDED_0 ... TOKEN_WIDE_CHAR_EMBEDDED_3:
+		if (!cache_get(p, end, token->embedded, 4))
+			return NULL;
+		break;
+	case TOKEN_SPECIAL:
+		if (!cache_get(p, end, &token->special, sizeof(token->special)))
+			return NULL;
+		break;
+	default:
+		return NULL;
+	}
+	return token;
+}
+
+/*
+ * Only the tokens go back on the free list.  Numbers and strings come from
+ * allocators which can't free single entries.
+ */
+static void free_token_chain(struct token *token)
+{
+	struct token *next;
+
+	while (token) {
+		next = token->next;
+		__free_token(token);
+		token = next;
+	}
+}
+
+static struct token *load_cached_tokens(const char *name, struct token_cache_key *key,
+					int idx, struct token **endp)
+{
+	struct token_cache_key saved;
+	struct token *begin = NULL, *token;
+	struct token **tail = &begin;
+	const unsigned char *p, *end;
+	unsigned char *data;
+	struct stat cache_st;
+	char magic[8];
+	int fd;
+
+	fd = open(token_cache_file(name, key), O_RDONLY);
+	if (fd < 0)
+		return NULL;
+	if (fstat(fd, &cache_st) || cache_st.st_size <= 0) {
+		close(fd);
+		return NULL;
+	}
+	data = map_file(fd, cache_st.st_size);
+	close(fd);
+	if (!data)
+		return NULL;
+
+	p = data;
+	end = data + cache_st.st_size;
+	if (!cache_get(&p, end, magic, 8) || memcmp(magic, TOKEN_CACHE_MAGIC, 8))
+		goto fail;
+	if (!cache_get(&p, end, &saved, sizeof(saved)) ||
+	    memcmp(&saved, key, sizeof(*key)) ||
+	    end - p < key->name_len || memcmp(p, name, key->name_len))
+		goto fail;
+	p += key->name_len;
+
+	for (;;) {
+		token = load_one_token(&p, end, idx);
+		if (!token)
+			goto fail;
+		token->next = NULL;
+		*tail = token;
+		tail = &token->next;
+		if (token_type(token) == TOKEN_STREAMEND)
+			break;
+	}
+	if (token_type(begin) != TOKEN_STREAMBEGIN)
+		goto fail;
+
+	eof_token_entry.next = &eof_token_entry;
+	eof_token_entry.pos.newline = 1;
+	token->next = &eof_token_entry;
+	*endp = token;
+	unmap_file(data, cache_st.st_size);
+	return begin;
+
+fail:
+	free_token_chain(begin);
+	unmap_file(data, cache_st.st_size);
+	return NULL;
+}
+
+/*
+ * Regular files are mapped and tokenized as one big buffer.  Pipes and
+ * anything we can't map go through read() a BUFSIZE at a time.
+ */
+static unsigned char *map_stream(int fd, struct stat *st, unsigned long *size)
+{
+	if (st->st_size <= 0 || st->st_size >= INT_MAX)
+		return NULL;
+	*size = st->st_size;
+	return map_file(fd, *size);
+}
+
 struct token * tokenize(const char *name, int fd, struct token *endtoken, const char **next_path)
 {
 	struct token *begin, *end;
 	stream_t stream;
 	unsigned char buffer[BUFSIZE];
+	unsigned char *map = NULL;
+	unsigned long map_size;
+	struct token_cache_key key;
+	struct stat st;
+	int regular, diagnostics;
 	int idx;
 
 	idx = init_stream(name, fd, next_path);
@@ -1042,8 +1549,31 @@ struct token * tokenize(const char *name, int fd, struct token *endtoken, const
 		return endtoken;
 	}
 
-	begin = setup_stream(&stream, idx, fd, buffer, 0);
+	regular = !fstat(fd, &st) && S_ISREG(st.st_mode);
+	if (regular)
+		map = map_stream(fd, &st, &map_size);
+	if (map && token_cache_dir) {
+		fill_cache_key(&key, name, &st, map, map_size);
+		begin = load_cached_tokens(name, &key, idx, &end);
+		if (begin) {
+			unmap_file(map, map_size);
+			token_cache_hits++;
+			goto done;
+		}
+		token_cache_misses++;
+	}
+
+	if (map)
+		begin = setup_stream(&stream, idx, -1, map, map_size);
+	else
+		begin = setup_stream(&stream, idx, fd, buffer, 0);
+	diagnostics = diagnostic_count;
 	end = tokenize_stream(&stream);
+	if (map)
+		unmap_file(map, map_size);
+	if (map && token_cache_dir && diagnostics == diagnostic_count)
+		save_cached_tokens(name, &key, begin);
+done:
 	if (endtoken)
 		end->next = endtoken;
 	return begin;
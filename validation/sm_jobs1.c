@@ -0,0 +1,48 @@
+struct foo {
+	int a;
+};
+
+struct foo *a;
+struct foo *b;
+struct foo *c;
+
+static inline void frob(struct foo *p)
+{
+	if (p)
+		p->a = 1;
+	p->a = 2;
+}
+
+void func1(void)
+{
+	if (a)
+		a->a = 1;
+	a->a = 1;
+}
+
+void func2(void)
+{
+	b->a = 1;
+	if (b)
+		b->a = 1;
+}
+
+void func3(void)
+{
+	frob(c);
+	if (c)
+		c->a = 1;
+	c->a = 1;
+}
+
+/*
+ * check-name: smatch --jobs #1
+ * check-command: smatch --jobs=2 sm_jobs1.c
+ *
+ * check-output-start
+sm_jobs1.c:20 func1() error: we previously assumed 'a' could be null (see line 18)
+sm_jobs1.c:26 func2() warn: variable dereferenced before check 'b' (see line 25)
+sm_jobs1.c:33 func3() warn: variable dereferenced before check 'c' (see line 32)
+sm_jobs1.c:13 frob() error: we previously assumed 'p' could be null (see line 11)
+ * check-output-end
+ */
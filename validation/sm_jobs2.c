@@ -0,0 +1,56 @@
+#include "check_debug.h"
+
+int a, b;
+
+void func1(void)
+{
+	int x = 0;
+
+	if (a)
+		x = 1;
+	__smatch_possible("x");
+	__smatch_implied(x);
+}
+
+void func2(void)
+{
+	int y;
+
+	if (a == 1)
+		y = 10;
+	else if (b)
+		y = 20;
+	else
+		y = 30;
+	__smatch_possible("y");
+	__smatch_implied(y);
+}
+
+void func3(void)
+{
+	if (b > 5)
+		__smatch_implied(b);
+}
+
+/*
+ * check-name: smatch --jobs #2
+ * check-command: smatch --jobs=3 -I.. sm_jobs2.c
+ *
+ * check-output-start
+sm_jobs2.c:11 func1() Possible values for x
+0-1
+1
+0
+sm_jobs2.c:11 func1() ===
+sm_jobs2.c:12 func1() implied: x = '0-1'
+sm_jobs2.c:25 func2() Possible values for y
+10,20,30
+20,30
+30
+20
+10
+sm_jobs2.c:25 func2() ===
+sm_jobs2.c:26 func2() implied: y = '10,20,30'
+sm_jobs2.c:32 func3() implied: b = '6-s32max'
+ * check-output-end
+ */
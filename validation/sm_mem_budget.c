@@ -0,0 +1,77 @@
+#include "check_debug.h"
+
+int a, b;
+
+#define CHECK()					\
+	if (a == 5)				\
+		x = 1;				\
+	else					\
+		x = 0;				\
+	if (x == 1)				\
+		__smatch_implied(a);		\
+	if (b == 1)				\
+		y = 1;				\
+	else if (b == 2)			\
+		y = 2;				\
+	else					\
+		y = 3;				\
+	__smatch_possible("y");
+
+void normal(void)
+{
+	int x, y;
+
+	CHECK()
+}
+
+void no_implications(void)
+{
+	int x, y;
+
+	__smatch_mem_budget_used(60);
+	CHECK()
+}
+
+void no_possible(void)
+{
+	int x, y;
+
+	__smatch_mem_budget_used(80);
+	CHECK()
+}
+
+void hairy(void)
+{
+	int x, y;
+
+	__smatch_mem_budget_used(100);
+	CHECK()
+}
+/*
+ * check-name: smatch memory budget
+ * check-command: smatch -I.. sm_mem_budget.c
+ *
+ * check-output-start
+sm_mem_budget.c:24 normal() implied: a = '5'
+sm_mem_budget.c:24 normal() Possible values for y
+1-3
+2-3
+3
+2
+1
+sm_mem_budget.c:24 normal() ===
+sm_mem_budget.c:32 no_implications() implied: a = 's32min-s32max'
+sm_mem_budget.c:32 no_implications() Possible values for y
+1-3
+2-3
+3
+2
+1
+sm_mem_budget.c:32 no_implications() ===
+sm_mem_budget.c:40 no_possible() implied: a = 's32min-s32max'
+sm_mem_budget.c:40 no_possible() Possible values for y
+1-3
+sm_mem_budget.c:40 no_possible() ===
+sm_mem_budget.c:47 hairy() Function too hairy.  Giving up.
+ * check-output-end
+ */
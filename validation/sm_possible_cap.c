@@ -0,0 +1,26 @@
+#include "check_debug.h"
+
+int a;
+
+void func(void)
+{
+	int x;
+
+	if (a == 1)
+		x = 1;
+	else if (a == 2)
+		x = 2;
+	else if (a == 3)
+		x = 3;
+	else
+		x = 4;
+	__smatch_possible_cover("x");
+}
+/*
+ * check-name: smatch possible cap
+ * check-command: smatch --max-possible=3 -I.. sm_possible_cap.c
+ *
+ * check-output-start
+sm_possible_cap.c:17 func() 'x' 3 possible states cover '1-4'
+ * check-output-end
+ */
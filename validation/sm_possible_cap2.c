@@ -0,0 +1,34 @@
+#include "check_debug.h"
+
+int a;
+
+int func(int x, int y)
+{
+	if (a == 1) {
+		if (x >= y)
+			return 0;
+	} else if (a == 2) {
+		if (x != y)
+			return 0;
+	} else if (a == 3) {
+		if (x <= y)
+			return 0;
+	} else {
+		if (x < y)
+			return 0;
+	}
+	__smatch_states("register_comparison");
+	return 1;
+}
+/*
+ * check-name: smatch possible cap #2
+ * check-command: smatch --max-possible=3 -I.. sm_possible_cap2.c
+ *
+ * check-output-start
+sm_possible_cap2.c:20 func() [register_comparison] 'x orig vs y' = 'undefined' (>, ==, <)
+sm_possible_cap2.c:20 func() [register_comparison] 'x vs x orig' = '=='
+sm_possible_cap2.c:20 func() [register_comparison] 'x vs y' = 'undefined' (>, ==, <)
+sm_possible_cap2.c:20 func() [register_comparison] 'x vs y orig' = 'undefined' (>, ==, <)
+sm_possible_cap2.c:20 func() [register_comparison] 'y vs y orig' = '=='
+ * check-output-end
+ */
@@ -0,0 +1,20 @@
+#include "check_debug.h"
+
+void func(int a, int b)
+{
+	if (a < 1 || a > 10)
+		return;
+	if (b < 20 || b > 30)
+		return;
+	__smatch_type_rl(int, "0-[<=$2]", a);
+	__smatch_type_rl(int, "0-[<=$2]", b);
+}
+/*
+ * check-name: smatch parse value #2
+ * check-command: smatch -I.. sm_val_parse2.c
+ *
+ * check-output-start
+sm_val_parse2.c:9 func() '0-[<=$2]' => '0-10'
+sm_val_parse2.c:10 func() '0-[<=$2]' => '0-30'
+ * check-output-end
+ */